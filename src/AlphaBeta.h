@@ -61,10 +61,27 @@ struct AlphaBeta {
 
     /**
      * Checks if children can be pruned or not by looking at the range given
-     * in the transposition table.
+     * in the transposition table. This is the case when the range lies
+     * entirely outside of the window, or when the score is exact.
      */
-    bool can_prune(const TranspositionTable::Entry& entry,
-                   const Who team) const;
+    bool can_prune(const TranspositionTable::Entry& entry) const;
+
+    /**
+     * Checks if the score lies strictly between alpha and beta.
+     * A child that was searched with a null window and returned such a score
+     * needs to be searched again with this window to get its true score.
+     */
+    bool inside(const score_t score) const;
+
+    /**
+     * Creates a window of width one that only tells whether a child of a node
+     * of `team' is better than the best score found so far or not.
+     *
+     * \param[in] team the team of the node whose children are searched.
+     *
+     * \return (alpha, alpha + 1) for HOME, (beta - 1, beta) for AWAY.
+     */
+    AlphaBeta null_window(const Who team) const;
 
     /**
      * alpha = best max/home score
@@ -100,11 +117,20 @@ inline bool AlphaBeta::can_prune(const score_t score, const Who team) const {
         : score <= alpha || score == NEG_INF;
 }
 
-inline bool AlphaBeta::can_prune(const TranspositionTable::Entry& entry,
-                                 const Who team) const {
+inline bool AlphaBeta::can_prune(
+        const TranspositionTable::Entry& entry) const {
+    return beta <= entry.lower_limit || alpha >= entry.upper_limit
+        || entry.lower_limit == entry.upper_limit;
+}
+
+inline bool AlphaBeta::inside(const score_t score) const {
+    return alpha < score && score < beta;
+}
+
+inline AlphaBeta AlphaBeta::null_window(const Who team) const {
     return team == Who::HOME
-        ? beta <= entry.lower_limit
-        : alpha >= entry.upper_limit;
+        ? AlphaBeta(alpha, alpha + 1)
+        : AlphaBeta(beta - 1, beta);
 }
 
 #endif /* end of include guard */
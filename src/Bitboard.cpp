@@ -0,0 +1,222 @@
+#include "Bitboard.h"
+
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+namespace {
+    /* Same order as the Status enum, as written by GameState */
+    const char* const STATUS_STRINGS[] = {
+        "GAME_ON", "HOME_WIN", "AWAY_WIN", "DRAW"
+    };
+
+    /**
+     * Random numbers from a fixed seed (splitmix64), so that keys are the
+     * same in every run.
+     */
+    std::array<Bitboard::bits_t, 64> make_zobrist() {
+        std::array<Bitboard::bits_t, 64> numbers;
+        Bitboard::bits_t x = 0x5eed;
+        for (auto& n : numbers) {
+            Bitboard::bits_t z = (x += 0x9e3779b97f4a7c15ULL);
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+            n = z ^ (z >> 31);
+        }
+        return numbers;
+    }
+}
+
+const std::array<Bitboard::bits_t, 64>& Bitboard::zobrist() {
+    static const std::array<bits_t, 64> numbers = make_zobrist();
+    return numbers;
+}
+
+Bitboard::Bitboard() {
+    Params& params = DomineeringState::getDomineeringParams();
+    set_size(params.intValue("ROWS"), params.intValue("COLS"));
+}
+
+Bitboard::Bitboard(const DomineeringState& state)
+    : who{state.getWho()}
+    , num_moves{state.getNumMoves()}
+    , status{state.getStatus()}
+{
+    set_size(state.ROWS, state.COLS);
+
+    const std::vector<char>& board = *state.getBoard1D();
+    for (unsigned i = 0; i < board.size(); i++) {
+        if (board[i] == state.HOMESYM) {
+            home |= bits_t(1) << i;
+        }
+        else if (board[i] == state.AWAYSYM) {
+            away |= bits_t(1) << i;
+        }
+    }
+    rehash();
+}
+
+Bitboard Bitboard::parse(const std::string& msg) {
+    DomineeringState state;
+    state.parseMsg(msg);
+    return Bitboard(state);
+}
+
+std::string Bitboard::to_msg() const {
+    Params& params = DomineeringState::getDomineeringParams();
+    const char home_sym = params.charValue("HOMESYM");
+    const char away_sym = params.charValue("AWAYSYM");
+    const char empty_sym = params.charValue("EMPTYSYM");
+
+    // The top row comes first, like in BoardGameState
+    std::string msg;
+    for (unsigned r = rows; r-- > 0;) {
+        for (unsigned c = 0; c < cols; c++) {
+            const bits_t g = grid(r, c);
+            msg += home & g ? home_sym : away & g ? away_sym : empty_sym;
+        }
+    }
+
+    msg += "[" + GameState::who2str(who) + ' '
+        + std::to_string(num_moves) + ' '
+        + STATUS_STRINGS[static_cast<int>(status)] + "]";
+    return msg;
+}
+
+DomineeringState Bitboard::to_state() const {
+    DomineeringState state;
+    state.parseMsg(to_msg());
+    return state;
+}
+
+void Bitboard::copy_grids(DomineeringState& state) const {
+    for (unsigned r = 0; r < rows; r++) {
+        for (unsigned c = 0; c < cols; c++) {
+            const bits_t g = grid(r, c);
+            state.setCell(r, c, home & g ? state.HOMESYM
+                          : away & g ? state.AWAYSYM
+                          : state.EMPTYSYM);
+        }
+    }
+}
+
+void Bitboard::rehash() {
+    keys.fill(0);
+    for (bits_t grids = occupied(); grids != 0; grids &= grids - 1) {
+        const unsigned i = lowest(grids);
+        for (unsigned s = 0; s < SYMMETRIES; s++) {
+            keys[s] ^= zobrist()[transform(s, i)];
+        }
+    }
+}
+
+unsigned Bitboard::canonical(bits_t& key) const {
+    unsigned symmetry = 0;
+    for (unsigned s = 0; s < symmetries(); s++) {
+        // Swapping rows and columns hands the move to the other team
+        const bool away = (who == Who::AWAY) != swaps_teams(s);
+        const bits_t k = keys[s] ^ (away ? AWAY_KEY : 0);
+        if (s == 0 || k < key) {
+            key = k;
+            symmetry = s;
+        }
+    }
+    return symmetry;
+}
+
+unsigned Bitboard::transform_move(const unsigned s,
+                                  const Location& move) const {
+    const unsigned i = index(move);
+    const unsigned step = who == Who::HOME ? 1 : cols;
+    return std::min(transform(s, i), transform(s, i + step));
+}
+
+Location Bitboard::restore_move(const unsigned s, const unsigned i) const {
+    // The domino is the other way round if the teams were swapped
+    const unsigned step = (who == Who::HOME) != swaps_teams(s) ? 1 : cols;
+    if (i + step >= rows * cols) {
+        return Location();
+    }
+    const unsigned inverse = Bitboard::inverse(s);
+    return location(who, std::min(transform(inverse, i),
+                                  transform(inverse, i + step)));
+}
+
+void Bitboard::set_size(const unsigned rows, const unsigned cols) {
+    this->rows = rows;
+    this->cols = cols;
+
+    // A larger board would shift grids off the end of the words and write
+    // past the end of the symmetry tables
+    const unsigned size = rows * cols;
+    if (size > 64) {
+        std::cerr << "Boards of " << rows << "x" << cols << " have more than"
+            << " 64 grids, which is all a Bitboard holds" << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+    grids = size == 64 ? ~bits_t(0) : (bits_t(1) << size) - 1;
+
+    bits_t last_col = 0;
+    for (unsigned r = 0; r < rows; r++) {
+        last_col |= grid(r, cols - 1);
+    }
+    not_last_col = grids & ~last_col;
+
+    tables = symmetry_tables(rows, cols);
+}
+
+const Bitboard::SymmetryTables* Bitboard::symmetry_tables(
+        const unsigned rows, const unsigned cols) {
+    static std::map<std::pair<unsigned, unsigned>,
+                    std::unique_ptr<SymmetryTables>> cache;
+    static std::mutex cache_lock;
+
+    std::lock_guard<std::mutex> lock(cache_lock);
+    std::unique_ptr<SymmetryTables>& tables = cache[{rows, cols}];
+    if (tables) {
+        return tables.get();
+    }
+    tables.reset(new SymmetryTables());
+
+    const unsigned size = rows * cols;
+    for (unsigned s = 0; s < SYMMETRIES; s++) {
+        for (unsigned i = 0; i < size; i++) {
+            unsigned r = i / cols, c = i % cols;
+            // Swap rows and columns first, then mirror. A board that is not
+            // square only has the mirror images, the rest are left as is.
+            if (swaps_teams(s)) {
+                if (rows != cols) {
+                    tables->grids[s][i] = i;
+                    continue;
+                }
+                std::swap(r, c);
+            }
+            if (s & 1) {
+                r = rows - 1 - r;
+            }
+            if (s & 2) {
+                c = cols - 1 - c;
+            }
+            tables->grids[s][i] = r * cols + c;
+        }
+    }
+
+    const std::array<bits_t, 64>& numbers = zobrist();
+    for (unsigned team = 0; team < 2; team++) {
+        const unsigned step = team == 0 ? 1 : cols;
+        for (unsigned i = 0; i + step < size; i++) {
+            for (unsigned s = 0; s < SYMMETRIES; s++) {
+                tables->dominoes[team][i][s] =
+                    numbers[tables->grids[s][i]]
+                    ^ numbers[tables->grids[s][i + step]];
+            }
+        }
+    }
+
+    return tables.get();
+}
+
+/* vim: tw=78:et:ts=4:sts=4:sw=4 */
@@ -0,0 +1,357 @@
+#ifndef BITBOARD_H_
+#define BITBOARD_H_
+
+#include "DomineeringState.h"
+#include "Location.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+/**
+ * A Domineering board that keeps the grids of each team in one 64-bit word,
+ * one bit per grid. Grid (r, c) is bit r * cols + c, with the rows numbered
+ * the same way as DomineeringState. Boards of up to 64 grids are supported.
+ *
+ * A domino is identified by the grid with the lower index: HOME's domino at
+ * i covers i and i + 1, AWAY's covers i and i + cols. This makes the legal
+ * moves of a team a couple of shifts and ANDs of the empty grids, and
+ * placing or removing a domino one XOR.
+ *
+ * The board also carries Zobrist keys of the covered grids, which are
+ * updated along with them and used to look boards up in the transposition
+ * table. There is one key per symmetry of the board, each computed as if the
+ * board had been mirrored or turned first, so that the transposition table
+ * can pick the same one for every board that is a mirror image of another.
+ */
+class Bitboard {
+public:
+    using bits_t = std::uint64_t;
+
+    /**
+     * Number of symmetries of a square board. Symmetries 0 to 3 are the
+     * board itself and its mirror images along the rows, the columns, and
+     * both. Symmetries 4 to 7 are the same after swapping rows and columns,
+     * which turns HOME's dominoes into AWAY's, and only exist on square
+     * boards.
+     */
+    static const unsigned SYMMETRIES = 8;
+
+    /**
+     * Empty board of the size in config/domineering.txt, HOME to move.
+     */
+    Bitboard();
+
+    /**
+     * Copies the board, the side to move, the number of moves and the status
+     * of the state.
+     *
+     * \param[in] state the state to copy.
+     */
+    explicit Bitboard(const DomineeringState& state);
+
+    /**
+     * Reads a board in the format of GameState::parseMsg: the board string of
+     * BoardGameState followed by the suffix of GameState.
+     *
+     * \param[in] msg the message.
+     *
+     * \return the board.
+     */
+    static Bitboard parse(const std::string& msg);
+
+    /**
+     * \return the board in the format read by GameState::parseMsg and
+     *         Bitboard::parse. Nothing is lost in the conversion.
+     */
+    std::string to_msg() const;
+
+    /**
+     * \return the state with the same board, side to move, number of moves
+     *         and status.
+     */
+    DomineeringState to_state() const;
+
+    /**
+     * Writes the grids, and nothing else, onto a state of the same size.
+     * Cheaper than Bitboard::to_state when the state can be reused.
+     *
+     * \param[out] state the state to write to.
+     */
+    void copy_grids(DomineeringState& state) const;
+
+    bits_t occupied() const { return home | away; }
+
+    bits_t empty() const { return ~occupied() & grids; }
+
+    /**
+     * \return every grid but the last column, where no horizontal domino
+     *         starts.
+     */
+    bits_t not_last_column() const { return not_last_col; }
+
+    /**
+     * \return every grid but the first column.
+     */
+    bits_t not_first_column() const { return not_last_col << 1; }
+
+    /**
+     * \param[in] team the team to move.
+     *
+     * \return the grids where the team can start a domino.
+     */
+    bits_t moves(const Who team) const;
+
+    /**
+     * \return the grids covered by a domino of the team starting at grid i.
+     */
+    bits_t domino(const Who team, const unsigned i) const;
+
+    /**
+     * \return the grids covered by the move.
+     */
+    bits_t domino(const Location& move) const;
+
+    /**
+     * Places the domino of the team starting at grid i, or removes it if it
+     * is already there. Does not change the side to move.
+     */
+    void toggle(const Who team, const unsigned i);
+
+    /**
+     * \return true if the move is one the team can make on this board.
+     */
+    bool legal(const Who team, const Location& move) const;
+
+    /**
+     * Computes the keys from scratch. Must be called after changing `home' or
+     * `away' other than by Bitboard::toggle.
+     */
+    void rehash();
+
+    /**
+     * \return the key of the covered grids.
+     */
+    bits_t key() const { return keys[0]; }
+
+    /**
+     * \return the number of symmetries of the board: all of them if it is
+     *         square, only the mirror images otherwise.
+     */
+    unsigned symmetries() const {
+        return rows == cols ? SYMMETRIES : SYMMETRIES / 2;
+    }
+
+    /**
+     * \return true if the symmetry swaps rows and columns, and with them
+     *         the teams.
+     */
+    static bool swaps_teams(const unsigned s) { return s >= SYMMETRIES / 2; }
+
+    /**
+     * \return the symmetry that undoes symmetry s.
+     */
+    static unsigned inverse(const unsigned s) {
+        // Every symmetry is its own inverse but the two quarter turns
+        return s == 5 ? 6 : s == 6 ? 5 : s;
+    }
+
+    /**
+     * \return the grid that grid i is moved to by symmetry s.
+     */
+    unsigned transform(const unsigned s, const unsigned i) const {
+        return tables->grids[s][i];
+    }
+
+    /**
+     * Picks the symmetry with the lowest key, with the side to move folded
+     * in, so that every image of the board picks the same key. Used to
+     * store a board and its images as one.
+     *
+     * \param[out] key the key of the board seen through the symmetry.
+     *
+     * \return the symmetry.
+     */
+    unsigned canonical(bits_t& key) const;
+
+    /**
+     * \return the grid the domino of a move of the side to move starts at,
+     *         once moved by symmetry s.
+     */
+    unsigned transform_move(const unsigned s, const Location& move) const;
+
+    /**
+     * Undoes Bitboard::transform_move.
+     *
+     * \return the move of the side to move that symmetry s moves to the
+     *         domino starting at grid i, or Location() if that domino does
+     *         not fit on the board.
+     */
+    Location restore_move(const unsigned s, const unsigned i) const;
+
+    /**
+     * \return the move of the team that starts at grid i.
+     */
+    Location location(const Who team, const unsigned i) const;
+
+    /**
+     * \return the grid the move starts at, whichever way round its grids
+     *         are given.
+     */
+    unsigned index(const Location& move) const;
+
+    /**
+     * \return the grid at row r and column c as a one bit mask.
+     */
+    bits_t grid(const unsigned r, const unsigned c) const {
+        return bits_t(1) << (r * cols + c);
+    }
+
+    /**
+     * Boards are the same if the same grids are empty and the same team is
+     * to move. Which team covered a grid makes no difference to the rest of
+     * the game.
+     */
+    bool operator==(const Bitboard& other) const;
+    bool operator!=(const Bitboard& other) const;
+
+    static unsigned count(const bits_t bits) {
+        return __builtin_popcountll(bits);
+    }
+
+    /**
+     * \return the index of the lowest set bit. bits must not be 0.
+     */
+    static unsigned lowest(const bits_t bits) {
+        return __builtin_ctzll(bits);
+    }
+
+    unsigned rows, cols;
+
+    /* Grids covered by each team */
+    bits_t home = 0, away = 0;
+
+    /* For each symmetry, the XOR of the Zobrist numbers of the grids the
+     * covered grids are moved to */
+    std::array<bits_t, SYMMETRIES> keys = {{}};
+
+    /* Side to move */
+    Who who = Who::HOME;
+    int num_moves = 0;
+    Status status = Status::GAME_ON;
+
+private:
+    /**
+     * A random number for each grid. The key of a board is the XOR of the
+     * numbers of its covered grids. Made on first use, so that boards can
+     * be built during static initialization.
+     */
+    static const std::array<bits_t, 64>& zobrist();
+
+    /**
+     * XORed into the key of Bitboard::canonical when AWAY is to move in the
+     * symmetry it is taken from.
+     */
+    static const bits_t AWAY_KEY = 0x3c6ef372fe94f82bULL;
+
+    /**
+     * Lookup tables for the symmetries of one board size, shared by every
+     * board of that size.
+     */
+    struct SymmetryTables {
+        /* Grid i moved by symmetry s, at [s][i] */
+        std::array<std::array<std::uint8_t, 64>, SYMMETRIES> grids;
+        /* The change to each key when the domino of a team starting at
+         * grid i is toggled, at [team][i][s] */
+        std::array<std::array<std::array<bits_t, SYMMETRIES>, 64>, 2>
+            dominoes;
+    };
+
+    /**
+     * \return the tables for boards of the given size, which are built the
+     *         first time they are asked for.
+     */
+    static const SymmetryTables* symmetry_tables(const unsigned rows,
+                                                 const unsigned cols);
+
+    /**
+     * Sets up the masks for a board of the given size. Exits with an
+     * error if it has more than 64 grids.
+     */
+    void set_size(const unsigned rows, const unsigned cols);
+
+    /* Every grid on the board */
+    bits_t grids;
+    /* Every grid but the last column, where no horizontal domino starts */
+    bits_t not_last_col;
+
+    const SymmetryTables* tables;
+};
+
+inline Bitboard::bits_t Bitboard::moves(const Who team) const {
+    const bits_t e = empty();
+    return team == Who::HOME
+        ? e & (e >> 1) & not_last_col
+        : e & (e >> cols);
+}
+
+inline Bitboard::bits_t Bitboard::domino(const Who team,
+                                         const unsigned i) const {
+    // Two grids side by side, or one above the other
+    const bits_t shape = team == Who::HOME
+        ? bits_t(3)
+        : bits_t(1) | bits_t(1) << cols;
+    return shape << i;
+}
+
+inline Bitboard::bits_t Bitboard::domino(const Location& move) const {
+    return grid(move.r1, move.c1) | grid(move.r2, move.c2);
+}
+
+inline void Bitboard::toggle(const Who team, const unsigned i) {
+    (team == Who::HOME ? home : away) ^= domino(team, i);
+    const auto& changes = tables->dominoes[team == Who::HOME ? 0 : 1][i];
+    for (unsigned s = 0; s < SYMMETRIES; s++) {
+        keys[s] ^= changes[s];
+    }
+}
+
+inline bool Bitboard::legal(const Who team, const Location& move) const {
+    const unsigned i = index(move);
+    return i < 64 && (moves(team) >> i & 1) && location(team, i) == move;
+}
+
+inline Location Bitboard::location(const Who team, const unsigned i) const {
+    const unsigned r = i / cols;
+    const unsigned c = i % cols;
+    return team == Who::HOME
+        ? Location(r, c, r, c + 1)
+        : Location(r, c, r + 1, c);
+}
+
+inline unsigned Bitboard::index(const Location& move) const {
+    return std::min(move.r1 * cols + move.c1, move.r2 * cols + move.c2);
+}
+
+inline bool Bitboard::operator==(const Bitboard& other) const {
+    return occupied() == other.occupied() && who == other.who;
+}
+
+inline bool Bitboard::operator!=(const Bitboard& other) const {
+    return !(*this == other);
+}
+
+namespace std {
+    template<>
+    struct hash<Bitboard> {
+        size_t operator()(const Bitboard& b) const {
+            return static_cast<size_t>(b.key());
+        }
+    };
+} // namespace std
+
+#endif /* end of include guard */
+
+/* vim: tw=78:et:ts=4:sts=4:sw=4 */
@@ -0,0 +1,233 @@
+#include "DfpnSolver.h"
+
+#include "Timer.h"
+
+#include <algorithm>
+#include <limits>
+
+const std::uint32_t DfpnSolver::INF;
+
+DfpnSolver::DfpnSolver() {
+}
+
+bool DfpnSolver::solve(const Bitboard& board,
+                       const double deadline,
+                       Who& winner,
+                       Location& move,
+                       const std::atomic<bool>* halt) {
+    if (table.empty()) {
+        set_table_size(megabytes);
+    }
+
+    not_last_col = board.not_last_column();
+    cols = board.cols;
+    this->deadline = deadline;
+    this->halt = halt;
+    stopped = false;
+    nodes_searched = 0;
+    nodes_until_check = CHECK_INTERVAL;
+
+    const Who me = board.who;
+    const Who other = me == Who::HOME ? Who::AWAY : Who::HOME;
+    const unsigned team = me == Who::HOME ? 0 : 1;
+    const bits_t empty = board.empty();
+
+    mid(empty, team, INF, INF);
+    lookup(empty, team, root_pn, root_dn);
+    if (stopped || (root_pn != 0 && root_dn != 0)) {
+        return false;
+    }
+
+    const bits_t all = moves(empty, team);
+    move = all != 0 ? board.location(me, Bitboard::lowest(all)) : Location();
+    if (root_pn != 0) {
+        winner = other;
+        return true;
+    }
+
+    // A child the opponent loses. Its entry may have been replaced since,
+    // in which case the children are proven again.
+    winner = me;
+    for (unsigned pass = 0; pass < 2; pass++) {
+        for (bits_t m = all; m != 0; m &= m - 1) {
+            const unsigned i = Bitboard::lowest(m);
+            const bits_t child = empty & ~domino(i, team);
+            if (pass == 1) {
+                mid(child, 1 - team, INF, INF);
+                if (stopped) {
+                    return false;
+                }
+            }
+
+            std::uint32_t pn, dn;
+            lookup(child, 1 - team, pn, dn);
+            if (dn == 0) {
+                move = board.location(me, i);
+                return true;
+            }
+        }
+    }
+    return true;
+}
+
+void DfpnSolver::set_table_size(const size_t megabytes) {
+    this->megabytes = megabytes;
+    size_t entries = 1;
+    while (entries * 2 * sizeof(Entry) <= megabytes * 1024 * 1024) {
+        entries *= 2;
+    }
+    entries = std::max<size_t>(entries, BUCKET_SIZE);
+    table.resize(entries);
+    mask = (entries - 1) & ~bits_t(BUCKET_SIZE - 1);
+    clear();
+}
+
+void DfpnSolver::clear() {
+    Entry unused;
+    unused.empty = 0;
+    unused.pn = unused.dn = 1;
+    unused.work = 0;
+    unused.team = 2;
+    std::fill(table.begin(), table.end(), unused);
+}
+
+/* Private methods */
+
+void DfpnSolver::mid(const bits_t empty,
+                     const unsigned team,
+                     const std::uint32_t thpn,
+                     const std::uint32_t thdn) {
+    const bits_t all = moves(empty, team);
+    if (all == 0) {
+        return;
+    }
+
+    nodes_searched++;
+    if (halt && *halt) {
+        stopped = true;
+    }
+    if (--nodes_until_check == 0) {
+        nodes_until_check = CHECK_INTERVAL;
+        if (Timer::now() >= deadline) {
+            stopped = true;
+        }
+    }
+    if (stopped) {
+        return;
+    }
+
+    const long unsigned start = nodes_searched;
+    const unsigned other = 1 - team;
+    bits_t children[64];
+    unsigned n = 0;
+    for (bits_t m = all; m != 0; m &= m - 1) {
+        children[n++] = empty & ~domino(Bitboard::lowest(m), team);
+    }
+
+    std::uint32_t pn, dn;
+    while (true) {
+        // The side to move needs one child the opponent loses, and all of
+        // them won by the opponent to lose
+        pn = INF;
+        dn = 0;
+        unsigned best = 0;
+        std::uint32_t best_pn = 0;
+        std::uint32_t second_dn = INF;
+        for (unsigned c = 0; c < n; c++) {
+            std::uint32_t child_pn, child_dn;
+            lookup(children[c], other, child_pn, child_dn);
+            if (child_dn < pn) {
+                second_dn = pn;
+                pn = child_dn;
+                best = c;
+                best_pn = child_pn;
+            }
+            else if (child_dn < second_dn) {
+                second_dn = child_dn;
+            }
+            dn = std::min(dn + child_pn, INF);
+        }
+
+        if (pn >= thpn || dn >= thdn || stopped) {
+            break;
+        }
+
+        // The child may use what is left of the disproof threshold once
+        // the other children are counted, and keeps the lead until its
+        // disproof number is EPSILON times past the second best
+        const std::uint32_t child_thpn = thdn - (dn - best_pn);
+        const std::uint32_t child_thdn = std::min<std::uint64_t>(
+            thpn, std::uint64_t(second_dn) * (1 + EPSILON) + 1);
+        mid(children[best], other, child_thpn, child_thdn);
+    }
+
+    if (!stopped) {
+        store(empty, team, pn, dn, nodes_searched - start + 1);
+    }
+}
+
+void DfpnSolver::lookup(const bits_t empty,
+                        const unsigned team,
+                        std::uint32_t& pn,
+                        std::uint32_t& dn) {
+    const Entry* entries = bucket(empty, team);
+    for (unsigned k = 0; k < BUCKET_SIZE; k++) {
+        if (entries[k].empty == empty && entries[k].team == team) {
+            pn = entries[k].pn;
+            dn = entries[k].dn;
+            return;
+        }
+    }
+
+    const bits_t all = moves(empty, team);
+    if (all == 0) {
+        pn = INF;
+        dn = 0;
+        return;
+    }
+    pn = 1;
+    dn = Bitboard::count(all);
+}
+
+void DfpnSolver::store(const bits_t empty,
+                       const unsigned team,
+                       const std::uint32_t pn,
+                       const std::uint32_t dn,
+                       const long unsigned work) {
+    Entry* entries = bucket(empty, team);
+    Entry* slot = entries;
+    for (unsigned k = 0; k < BUCKET_SIZE; k++) {
+        if (entries[k].empty == empty && entries[k].team == team) {
+            slot = entries + k;
+            break;
+        }
+        if (entries[k].work < slot->work) {
+            slot = entries + k;
+        }
+    }
+
+    // Searching a position again adds to the work it took
+    const bool same = slot->empty == empty && slot->team == team;
+    const long unsigned total = (same ? slot->work : 0) + work;
+    slot->empty = empty;
+    slot->team = team;
+    slot->pn = pn;
+    slot->dn = dn;
+    slot->work = std::min<long unsigned>(
+        total, std::numeric_limits<std::uint32_t>::max());
+}
+
+DfpnSolver::Entry* DfpnSolver::bucket(const bits_t empty,
+                                      const unsigned team) {
+    // Positions often differ in a few grids only, all of their bits have
+    // to make it to the index
+    bits_t h = empty ^ team;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return &table[h & mask];
+}
+
+/* vim: tw=78:et:ts=4:sts=4:sw=4 */
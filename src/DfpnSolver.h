@@ -0,0 +1,190 @@
+#ifndef DFPN_SOLVER_H_
+#define DFPN_SOLVER_H_
+
+#include "Bitboard.h"
+#include "Location.h"
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Proves who wins a position with depth-first proof-number search (df-pn).
+ *
+ * Every position has a proof number, the least number of positions that
+ * still have to be solved to show that the side to move wins, and a
+ * disproof number, the same to show that it loses. The side to move wins
+ * if one of its moves loses for the opponent, so the proof number of a
+ * position is the smallest disproof number of its children, and the
+ * disproof number is the sum of their proof numbers. The search always
+ * goes down to the child that is cheapest to solve, and only comes back up
+ * once the numbers of the position pass the thresholds it was given, so
+ * that it spends its time where the tree is narrow instead of searching
+ * every line to the same depth. Domineering trees are very uneven, a team
+ * often runs out of moves long before the other.
+ *
+ * The numbers are kept in a table of their own, keyed exactly by the empty
+ * grids and the side to move. A position not in the table is worth one to
+ * prove and as many as it has moves to disprove.
+ *
+ * A child is searched until its disproof number is well past the one of
+ * the second best child (the 1 + epsilon trick), not just past it. With a
+ * small epsilon, the search keeps switching between children whose
+ * numbers are about the same, which is most of them in Domineering.
+ */
+class DfpnSolver {
+public:
+    using bits_t = Bitboard::bits_t;
+
+    /**
+     * Proof and disproof numbers of a position that is lost and won.
+     */
+    static const std::uint32_t INF = 1u << 30;
+
+    /**
+     * Memory for the table unless told otherwise.
+     */
+    static const size_t DEFAULT_MEGABYTES = 64;
+
+    /**
+     * Number of nodes between two looks at the clock.
+     */
+    static const unsigned CHECK_INTERVAL = 4096;
+
+    /**
+     * How far past the second best child the best one is searched, see
+     * above. Anything less than 4 searches many times as many nodes on
+     * random positions of 8x8 boards.
+     */
+    static const std::uint32_t EPSILON = 7;
+
+    DfpnSolver();
+
+    /**
+     * Proves a position. The table is kept from one call to the next.
+     *
+     * \param[in] board the position.
+     *
+     * \param[in] deadline when to give up, as given by Timer::now.
+     *
+     * \param[out] winner the team that wins.
+     *
+     * \param[out] move a winning move if the side to move wins, any legal
+     *                  move if it loses, Location() if it has none.
+     *
+     * \param[in] halt if given, set by another thread to give up.
+     *
+     * \return false if time ran out or the search was halted before the
+     *         position was proven.
+     */
+    bool solve(const Bitboard& board,
+               const double deadline,
+               Who& winner,
+               Location& move,
+               const std::atomic<bool>* halt = nullptr);
+
+    /**
+     * Changes the size of the table, rounded down to a power of two, and
+     * forgets every position.
+     */
+    void set_table_size(const size_t megabytes);
+
+    /**
+     * Forgets every position.
+     */
+    void clear();
+
+    /**
+     * \return the number of positions expanded by the last solve.
+     */
+    long unsigned get_nodes_searched() const { return nodes_searched; }
+
+    /**
+     * \return the proof number of the position of the last solve, as far as
+     *         it got.
+     */
+    std::uint32_t get_proof_number() const { return root_pn; }
+
+    /**
+     * \return the disproof number of the position of the last solve.
+     */
+    std::uint32_t get_disproof_number() const { return root_dn; }
+
+private:
+    struct Entry {
+        bits_t empty;
+        std::uint32_t pn, dn;
+        /* Nodes expanded to get the numbers, the ones that took the least
+         * are replaced first */
+        std::uint32_t work;
+        /* The side to move, 0 for HOME, 1 for AWAY, 2 for an unused slot */
+        std::uint32_t team;
+    };
+
+    static const unsigned BUCKET_SIZE = 4;
+
+    std::vector<Entry> table;
+    size_t megabytes = DEFAULT_MEGABYTES;
+    bits_t mask = 0;
+
+    /* Masks of the board being solved */
+    bits_t not_last_col = 0;
+    unsigned cols = 0;
+
+    double deadline = 0;
+    const std::atomic<bool>* halt = nullptr;
+    bool stopped = false;
+    long unsigned nodes_searched = 0;
+    unsigned nodes_until_check = CHECK_INTERVAL;
+
+    std::uint32_t root_pn = 1, root_dn = 1;
+
+    /**
+     * Searches below a position until its proof number reaches `thpn' or
+     * its disproof number reaches `thdn', and stores them in the table.
+     */
+    void mid(const bits_t empty,
+             const unsigned team,
+             const std::uint32_t thpn,
+             const std::uint32_t thdn);
+
+    /**
+     * Gets the numbers of a position from the table, or their first
+     * estimate if it is not there.
+     */
+    void lookup(const bits_t empty,
+                const unsigned team,
+                std::uint32_t& pn,
+                std::uint32_t& dn);
+
+    void store(const bits_t empty,
+               const unsigned team,
+               const std::uint32_t pn,
+               const std::uint32_t dn,
+               const long unsigned work);
+
+    /**
+     * \return the grids where the team can start a domino.
+     */
+    bits_t moves(const bits_t empty, const unsigned team) const {
+        return team == 0
+            ? empty & empty >> 1 & not_last_col
+            : empty & empty >> cols;
+    }
+
+    /**
+     * \return the grids covered by the domino of the team at grid i.
+     */
+    bits_t domino(const unsigned i, const unsigned team) const {
+        return (bits_t(1) << i) | (bits_t(1) << (i + (team == 0 ? 1 : cols)));
+    }
+
+    /**
+     * \return the first entry of the bucket of the position.
+     */
+    Entry* bucket(const bits_t empty, const unsigned team);
+};
+
+#endif /* end of include guard */
+
+/* vim: tw=78:et:ts=4:sts=4:sw=4 */
@@ -0,0 +1,141 @@
+#include "EndgameSolver.h"
+
+#include "Timer.h"
+
+#include <algorithm>
+
+EndgameSolver::EndgameSolver() {
+}
+
+bool EndgameSolver::solve(const Bitboard& board,
+                          const double deadline,
+                          Who& winner,
+                          Location& move) {
+    allocate();
+
+    not_last_col = board.not_last_column();
+    cols = board.cols;
+    this->deadline = deadline;
+    stopped = false;
+    nodes_searched = 0;
+    nodes_until_check = CHECK_INTERVAL;
+
+    const Who me = board.who;
+    const Who other = me == Who::HOME ? Who::AWAY : Who::HOME;
+    const unsigned team = me == Who::HOME ? 0 : 1;
+    const bits_t empty = board.empty();
+    const bits_t all = moves(empty, team);
+
+    // The root has to come up with a move, so its children are solved one
+    // by one instead of through EndgameSolver::wins
+    move = all != 0 ? board.location(me, Bitboard::lowest(all)) : Location();
+    winner = other;
+    for (bits_t m = all; m != 0; m &= m - 1) {
+        const unsigned i = Bitboard::lowest(m);
+        const bool lost = !wins(empty & ~domino(i, team), 1 - team);
+        if (stopped) {
+            return false;
+        }
+        if (lost) {
+            winner = me;
+            move = board.location(me, i);
+            break;
+        }
+    }
+    return true;
+}
+
+void EndgameSolver::set_table_size(const size_t megabytes) {
+    this->megabytes = megabytes;
+    size_t entries = 1;
+    while (entries * 2 * sizeof(Entry) <= megabytes * 1024 * 1024) {
+        entries *= 2;
+    }
+    entries = std::max<size_t>(entries, BUCKET_SIZE);
+    table.assign(entries, Entry());
+    mask = (entries - 1) & ~bits_t(BUCKET_SIZE - 1);
+}
+
+void EndgameSolver::clear() {
+    std::fill(table.begin(), table.end(), Entry());
+}
+
+/* Private methods */
+
+bool EndgameSolver::wins(const bits_t empty, const unsigned team) {
+    const bits_t mine = moves(empty, team);
+    if (mine == 0) {
+        return false;
+    }
+
+    nodes_searched++;
+    if (--nodes_until_check == 0) {
+        nodes_until_check = CHECK_INTERVAL;
+        if (Timer::now() >= deadline) {
+            stopped = true;
+            return false;
+        }
+    }
+
+    Entry* entries = bucket(empty, team);
+    for (unsigned k = 0; k < BUCKET_SIZE; k++) {
+        if (entries[k].empty == empty && entries[k].flags & USED
+                && (entries[k].flags & 1) == team) {
+            return entries[k].flags & WIN;
+        }
+    }
+
+    // Order the moves by how many moves they leave to each team. A move
+    // that leaves the opponent none wins.
+    const unsigned other = 1 - team;
+    unsigned order[64];
+    int keys[64];
+    unsigned n = 0;
+    bool result = false;
+    for (bits_t m = mine; m != 0; m &= m - 1) {
+        const unsigned i = Bitboard::lowest(m);
+        const bits_t next = empty & ~domino(i, team);
+        const bits_t replies = moves(next, other);
+        if (replies == 0) {
+            result = true;
+            break;
+        }
+        const int key = static_cast<int>(Bitboard::count(moves(next, team)))
+            - static_cast<int>(Bitboard::count(replies));
+
+        unsigned j = n++;
+        for (; j > 0 && keys[j - 1] < key; j--) {
+            order[j] = order[j - 1];
+            keys[j] = keys[j - 1];
+        }
+        order[j] = i;
+        keys[j] = key;
+    }
+
+    for (unsigned j = 0; j < n && !result; j++) {
+        result = !wins(empty & ~domino(order[j], team), other);
+        if (stopped) {
+            return false;
+        }
+    }
+
+    // The first entry keeps the position with the most empty grids, which
+    // took the longest to solve
+    const std::uint32_t grids = Bitboard::count(empty);
+    Entry& slot = entries[0].grids <= grids ? entries[0] : entries[1];
+    slot.empty = empty;
+    slot.flags = USED | (result ? WIN : 0) | team;
+    slot.grids = grids;
+    return result;
+}
+
+EndgameSolver::Entry* EndgameSolver::bucket(const bits_t empty,
+                                            const unsigned team) {
+    bits_t h = empty ^ team;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return &table[h & mask];
+}
+
+/* vim: tw=78:et:ts=4:sts=4:sw=4 */
@@ -0,0 +1,141 @@
+#ifndef ENDGAME_SOLVER_H_
+#define ENDGAME_SOLVER_H_
+
+#include "Bitboard.h"
+#include "Location.h"
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * Solves positions to the end of the game. Only who wins matters, so there
+ * is no evaluation and no window: a position is won if one of its moves
+ * leads to a position lost for the opponent, and the first such move stops
+ * the search.
+ *
+ * A position is nothing but its empty grids and the side to move, which
+ * makes the table entries exact: each one keeps the empty grids, the side
+ * to move and one bit for the result. Moves are tried in the order of how
+ * many moves they leave the side to move compared to the opponent, and a
+ * move that leaves the opponent nothing is taken at once.
+ */
+class EndgameSolver {
+public:
+    using bits_t = Bitboard::bits_t;
+
+    /**
+     * Memory for the table unless told otherwise.
+     */
+    static const size_t DEFAULT_MEGABYTES = 16;
+
+    /**
+     * Number of nodes between two looks at the clock.
+     */
+    static const unsigned CHECK_INTERVAL = 4096;
+
+    EndgameSolver();
+
+    /**
+     * Solves a position.
+     *
+     * \param[in] board the position.
+     *
+     * \param[in] deadline when to give up, as given by Timer::now.
+     *
+     * \param[out] winner the team that wins.
+     *
+     * \param[out] move a winning move if the side to move wins, any legal
+     *                  move if it loses, Location() if it has none.
+     *
+     * \return false if time ran out before the position was solved.
+     */
+    bool solve(const Bitboard& board,
+               const double deadline,
+               Who& winner,
+               Location& move);
+
+    /**
+     * Changes the size of the table, rounded down to a power of two, and
+     * forgets every position.
+     */
+    void set_table_size(const size_t megabytes);
+
+    /**
+     * Forgets every position.
+     */
+    void clear();
+
+    /**
+     * Allocates the table now instead of on the first call to solve, which
+     * would count the time it takes against its deadline.
+     */
+    void allocate() {
+        if (table.empty()) {
+            set_table_size(megabytes);
+        }
+    }
+
+    /**
+     * \return the number of positions visited by the last solve.
+     */
+    long unsigned get_nodes_searched() const { return nodes_searched; }
+
+private:
+    /* The side to move is in the lowest bit of `flags', the result above */
+    struct Entry {
+        bits_t empty;
+        std::uint32_t flags;
+        std::uint32_t grids;
+    };
+
+    /* Two entries per bucket: one kept for the most empty grids, one
+     * always replaced */
+    static const unsigned BUCKET_SIZE = 2;
+
+    static const std::uint32_t USED = 4;
+    static const std::uint32_t WIN = 2;
+
+    std::vector<Entry> table;
+    size_t megabytes = DEFAULT_MEGABYTES;
+    bits_t mask = 0;
+
+    /* Masks of the board being solved */
+    bits_t not_last_col = 0;
+    unsigned cols = 0;
+
+    double deadline = 0;
+    bool stopped = false;
+    long unsigned nodes_searched = 0;
+    unsigned nodes_until_check = CHECK_INTERVAL;
+
+    /**
+     * \return true if the team to move wins when only the given grids are
+     *         empty. Meaningless once `stopped' is set.
+     */
+    bool wins(const bits_t empty, const unsigned team);
+
+    /**
+     * \return the grids where the team can start a domino.
+     */
+    bits_t moves(const bits_t empty, const unsigned team) const {
+        return team == 0
+            ? empty & empty >> 1 & not_last_col
+            : empty & empty >> cols;
+    }
+
+    /**
+     * \return the grids covered by the domino of the team at grid i.
+     */
+    bits_t domino(const unsigned i, const unsigned team) const {
+        return (bits_t(1) << i) | (bits_t(1) << (i + (team == 0 ? 1 : cols)));
+    }
+
+    /**
+     * \return the first bucket entry of the position.
+     */
+    Entry* bucket(const bits_t empty, const unsigned team);
+};
+
+#endif /* end of include guard */
+
+/* vim: tw=78:et:ts=4:sts=4:sw=4 */
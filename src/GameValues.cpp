@@ -0,0 +1,285 @@
+#include "GameValues.h"
+
+#include <algorithm>
+#include <sstream>
+
+const GameValues::id_t GameValues::ZERO;
+const GameValues::id_t GameValues::NOT_COPIED;
+
+GameValues::GameValues() {
+    intern({}, {});
+}
+
+GameValues::id_t GameValues::game(std::vector<id_t> left,
+                                  std::vector<id_t> right) {
+    while (true) {
+        std::sort(left.begin(), left.end());
+        left.erase(std::unique(left.begin(), left.end()), left.end());
+        std::sort(right.begin(), right.end());
+        right.erase(std::unique(right.begin(), right.end()), right.end());
+
+        remove_dominated(left, true);
+        remove_dominated(right, false);
+
+        const id_t g = intern(left, right);
+        if (!bypass_reversible(g, left, right)) {
+            return g;
+        }
+    }
+}
+
+GameValues::id_t GameValues::integer(const int n) {
+    if (n == 0) {
+        return ZERO;
+    }
+
+    const auto found = integer_memo.find(n);
+    if (found != integer_memo.end()) {
+        return found->second;
+    }
+
+    const id_t result = n > 0
+        ? game({integer(n - 1)}, {})
+        : game({}, {integer(n + 1)});
+    integer_memo[n] = result;
+    return result;
+}
+
+GameValues::id_t GameValues::add(const id_t a, const id_t b) {
+    if (a == ZERO) {
+        return b;
+    }
+    if (b == ZERO) {
+        return a;
+    }
+
+    const std::uint64_t key = static_cast<std::uint64_t>(std::min(a, b)) << 32
+        | std::max(a, b);
+    const auto found = sum_memo.find(key);
+    if (found != sum_memo.end()) {
+        return found->second;
+    }
+
+    // The options may move while the sums are added
+    const Form form_a = forms[a];
+    const Form form_b = forms[b];
+    std::vector<id_t> left, right;
+    for (const id_t option : form_a.first) {
+        left.push_back(add(option, b));
+    }
+    for (const id_t option : form_b.first) {
+        left.push_back(add(a, option));
+    }
+    for (const id_t option : form_a.second) {
+        right.push_back(add(option, b));
+    }
+    for (const id_t option : form_b.second) {
+        right.push_back(add(a, option));
+    }
+
+    const id_t sum = game(left, right);
+    sum_memo[key] = sum;
+    return sum;
+}
+
+bool GameValues::less_equal(const id_t a, const id_t b) {
+    if (a == b) {
+        return true;
+    }
+
+    const std::uint64_t key = static_cast<std::uint64_t>(a) << 32 | b;
+    const auto found = less_equal_memo.find(key);
+    if (found != less_equal_memo.end()) {
+        return found->second;
+    }
+
+    // a <= b unless a has a left option at least b, or b has a right
+    // option at most a
+    bool result = true;
+    for (const id_t option : forms[a].first) {
+        if (less_equal(b, option)) {
+            result = false;
+            break;
+        }
+    }
+    if (result) {
+        for (const id_t option : forms[b].second) {
+            if (less_equal(option, a)) {
+                result = false;
+                break;
+            }
+        }
+    }
+
+    less_equal_memo[key] = result;
+    return result;
+}
+
+GameValues::Sign GameValues::sign(const id_t g) {
+    const bool at_most = less_equal(g, ZERO);
+    const bool at_least = less_equal(ZERO, g);
+    return at_most
+        ? (at_least ? Sign::ZERO : Sign::NEGATIVE)
+        : (at_least ? Sign::POSITIVE : Sign::FUZZY);
+}
+
+std::string GameValues::to_string(const id_t g) {
+    double value;
+    if (number(g, value)) {
+        std::ostringstream oss;
+        oss << value;
+        return oss.str();
+    }
+
+    unsigned n;
+    if (nimber(g, n)) {
+        return n == 1 ? "*" : "*" + std::to_string(n);
+    }
+
+    // A number plus * is {x|x}
+    if (forms[g].first.size() == 1 && forms[g].first == forms[g].second
+            && number(forms[g].first.front(), value)) {
+        std::ostringstream oss;
+        oss << value << "*";
+        return oss.str();
+    }
+
+    // Up is {0|*}, and down is its negative
+    const id_t star = game({ZERO}, {ZERO});
+    if (forms[g] == Form{{ZERO}, {star}}) {
+        return "^";
+    }
+    if (forms[g] == Form{{star}, {ZERO}}) {
+        return "v";
+    }
+
+    std::string s = "{";
+    for (size_t i = 0; i < forms[g].first.size(); i++) {
+        s += (i > 0 ? "," : "") + to_string(forms[g].first[i]);
+    }
+    s += "|";
+    for (size_t i = 0; i < forms[g].second.size(); i++) {
+        s += (i > 0 ? "," : "") + to_string(forms[g].second[i]);
+    }
+    return s + "}";
+}
+
+/* Private methods */
+
+GameValues::id_t GameValues::intern(std::vector<id_t> left,
+                                    std::vector<id_t> right) {
+    std::sort(left.begin(), left.end());
+    std::sort(right.begin(), right.end());
+    Form form{std::move(left), std::move(right)};
+
+    const auto found = index.find(form);
+    if (found != index.end()) {
+        return found->second;
+    }
+
+    const id_t g = forms.size();
+    forms.push_back(form);
+    index.emplace(std::move(form), g);
+    return g;
+}
+
+void GameValues::remove_dominated(std::vector<id_t>& options,
+                                  const bool for_left) {
+    // Options are canonical and distinct, so no two are equal
+    std::vector<id_t> kept;
+    for (const id_t option : options) {
+        bool dominated = false;
+        for (const id_t other : options) {
+            if (other != option && (for_left
+                                    ? less_equal(option, other)
+                                    : less_equal(other, option))) {
+                dominated = true;
+                break;
+            }
+        }
+        if (!dominated) {
+            kept.push_back(option);
+        }
+    }
+    options.swap(kept);
+}
+
+bool GameValues::bypass_reversible(const id_t g,
+                                   std::vector<id_t>& left,
+                                   std::vector<id_t>& right) {
+    // A left option is reversible if one of its right options is at most
+    // g: Right would answer it at once, so Left may as well move to the
+    // left options of that answer
+    for (size_t i = 0; i < left.size(); i++) {
+        const std::vector<id_t> answers = forms[left[i]].second;
+        for (const id_t answer : answers) {
+            if (less_equal(answer, g)) {
+                const std::vector<id_t> replacements = forms[answer].first;
+                left.erase(left.begin() + i);
+                left.insert(left.end(),
+                            replacements.begin(), replacements.end());
+                return true;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < right.size(); i++) {
+        const std::vector<id_t> answers = forms[right[i]].first;
+        for (const id_t answer : answers) {
+            if (less_equal(g, answer)) {
+                const std::vector<id_t> replacements = forms[answer].second;
+                right.erase(right.begin() + i);
+                right.insert(right.end(),
+                             replacements.begin(), replacements.end());
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+bool GameValues::number(const id_t g, double& value) {
+    // In canonical form, a number has at most one option on each side,
+    // both numbers, and is the simplest number between them
+    const Form& form = forms[g];
+    if (form.first.size() > 1 || form.second.size() > 1) {
+        return false;
+    }
+
+    double left_value = 0, right_value = 0;
+    const bool has_left = !form.first.empty();
+    const bool has_right = !form.second.empty();
+    if ((has_left && !number(form.first.front(), left_value))
+            || (has_right && !number(form.second.front(), right_value))
+            || (has_left && has_right && left_value >= right_value)) {
+        return false;
+    }
+
+    value = has_left && has_right ? (left_value + right_value) / 2
+        : has_left ? left_value + 1
+        : has_right ? right_value - 1
+        : 0;
+    return true;
+}
+
+bool GameValues::nimber(const id_t g, unsigned& n) const {
+    // *n is {0, *, ..., *(n-1) | 0, *, ..., *(n-1)}
+    const Form& form = forms[g];
+    if (form.first != form.second) {
+        return false;
+    }
+
+    std::vector<bool> seen(form.first.size(), false);
+    for (const id_t option : form.first) {
+        unsigned m;
+        if (!nimber(option, m) || m >= seen.size() || seen[m]) {
+            return false;
+        }
+        seen[m] = true;
+    }
+    n = form.first.size();
+    return true;
+}
+
+/* vim: tw=78:et:ts=4:sts=4:sw=4 */
@@ -0,0 +1,188 @@
+#ifndef GAME_VALUES_H_
+#define GAME_VALUES_H_
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * Values of combinatorial games, HOME being Left and AWAY being Right.
+ *
+ * A game is given by the games its left and right options lead to, and is
+ * kept in canonical form: dominated options are removed and reversible
+ * ones bypassed, so that games of equal value are the same game. Each game
+ * is stored once and referred to by its index, which makes comparing two
+ * values for equality comparing two indices. Numbers, switches and
+ * infinitesimals such as * and up are all games of this kind.
+ *
+ * The value of a sum of games tells who wins it: HOME whoever starts if it
+ * is positive, AWAY if it is negative, the second player if it is zero,
+ * and the first player otherwise.
+ */
+class GameValues {
+public:
+    using id_t = std::uint32_t;
+
+    /**
+     * How a game compares with zero.
+     */
+    enum class Sign {
+        ZERO,
+        POSITIVE,
+        NEGATIVE,
+        FUZZY
+    };
+
+    /**
+     * The game where no one can move.
+     */
+    static const id_t ZERO = 0;
+
+    GameValues();
+
+    /**
+     * \param[in] left the left options, in canonical form.
+     *
+     * \param[in] right the right options, in canonical form.
+     *
+     * \return the game with the given options, in canonical form.
+     */
+    id_t game(std::vector<id_t> left, std::vector<id_t> right);
+
+    /**
+     * \return the integer n.
+     */
+    id_t integer(const int n);
+
+    /**
+     * \return the sum of two games.
+     */
+    id_t add(const id_t a, const id_t b);
+
+    /**
+     * \return true if a is less than or equal to b.
+     */
+    bool less_equal(const id_t a, const id_t b);
+
+    Sign sign(const id_t g);
+
+    /**
+     * Copies a game and its options from somewhere else, for instance
+     * another GameValues or a file.
+     *
+     * \param[in] g the game to copy, as numbered where it comes from.
+     *
+     * \param[in] left_of a function that returns the left options of a game
+     *                    where it comes from.
+     *
+     * \param[in] right_of the same for the right options.
+     *
+     * \param[in,out] copied the games copied so far, indexed by their
+     *                       number where they come from. Unknown ones are
+     *                       NOT_COPIED.
+     *
+     * \return the game here.
+     */
+    template <typename LeftOf, typename RightOf>
+    id_t copy(const id_t g,
+              const LeftOf& left_of,
+              const RightOf& right_of,
+              std::vector<id_t>& copied);
+
+    static const id_t NOT_COPIED = ~id_t(0);
+
+    const std::vector<id_t>& left(const id_t g) const {
+        return forms[g].first;
+    }
+
+    const std::vector<id_t>& right(const id_t g) const {
+        return forms[g].second;
+    }
+
+    /**
+     * \return the number of games stored, including forms that turned out
+     *         not to be canonical.
+     */
+    size_t size() const { return forms.size(); }
+
+    /**
+     * \return the game written as a number, as *n, a number plus *, up or
+     *         down, or as {left options | right options} otherwise.
+     */
+    std::string to_string(const id_t g);
+
+private:
+    using Form = std::pair<std::vector<id_t>, std::vector<id_t>>;
+
+    std::vector<Form> forms;
+    std::map<Form, id_t> index;
+
+    std::unordered_map<std::uint64_t, bool> less_equal_memo;
+    std::unordered_map<std::uint64_t, id_t> sum_memo;
+    std::unordered_map<int, id_t> integer_memo;
+
+    /**
+     * \return the game with exactly the given options, which may not be in
+     *         canonical form.
+     */
+    id_t intern(std::vector<id_t> left, std::vector<id_t> right);
+
+    /**
+     * Removes the options that are no better for their player than another
+     * one.
+     */
+    void remove_dominated(std::vector<id_t>& options, const bool for_left);
+
+    /**
+     * Replaces the first reversible option of g by the options it reverses
+     * through.
+     *
+     * \return true if an option was replaced.
+     */
+    bool bypass_reversible(const id_t g,
+                           std::vector<id_t>& left,
+                           std::vector<id_t>& right);
+
+    /**
+     * \return true if g is a number, and its value in that case.
+     */
+    bool number(const id_t g, double& value);
+
+    /**
+     * \return true if g is *n, and n in that case.
+     */
+    bool nimber(const id_t g, unsigned& n) const;
+};
+
+template <typename LeftOf, typename RightOf>
+GameValues::id_t GameValues::copy(const id_t g,
+                                  const LeftOf& left_of,
+                                  const RightOf& right_of,
+                                  std::vector<id_t>& copied) {
+    if (g < copied.size() && copied[g] != NOT_COPIED) {
+        return copied[g];
+    }
+
+    std::vector<id_t> left, right;
+    for (const id_t option : left_of(g)) {
+        left.push_back(copy(option, left_of, right_of, copied));
+    }
+    for (const id_t option : right_of(g)) {
+        right.push_back(copy(option, left_of, right_of, copied));
+    }
+
+    // Already canonical where it comes from
+    const id_t here = intern(left, right);
+    if (copied.size() <= g) {
+        copied.resize(g + 1, NOT_COPIED);
+    }
+    copied[g] = here;
+    return here;
+}
+
+#endif /* end of include guard */
+
+/* vim: tw=78:et:ts=4:sts=4:sw=4 */
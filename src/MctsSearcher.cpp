@@ -0,0 +1,318 @@
+#include "MctsSearcher.h"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+const std::uint32_t MctsSearcher::NONE;
+constexpr float MctsSearcher::EXPLORATION;
+
+MctsSearcher::MctsSearcher() {
+    timer = Timer(240);
+}
+
+void MctsSearcher::reset() {
+    trees.clear();
+    timer = Timer(240);
+}
+
+Location MctsSearcher::search(const DomineeringState& state) {
+    timer.click();
+    const double start = Timer::now();
+    const float budget = move_time > 0 ? move_time : timer.get_move_time();
+
+    const Bitboard board(state);
+    not_last_col = board.not_last_column();
+    cols = board.cols;
+    const unsigned team = board.who == Who::HOME ? 0 : 1;
+    const bits_t empty = board.empty();
+
+    // The trees of the last move are kept for the positions they share
+    // with this one, unless they are running out of room
+    trees.resize(num_threads);
+    for (size_t t = 0; t < trees.size(); t++) {
+        Tree& tree = trees[t];
+        if (tree.nodes.empty()
+                || tree.nodes_used * 2 > tree.nodes.size()
+                || tree.edges_used * 2 > tree.edges.size()) {
+            clear(tree);
+        }
+        if (tree.rng == 0) {
+            tree.rng = 0x9e3779b97f4a7c15ULL * (t + 1);
+        }
+        tree.playouts = 0;
+    }
+
+    std::vector<std::thread> helpers;
+    for (size_t t = 1; t < trees.size(); t++) {
+        helpers.emplace_back([this, t, empty, team, start, budget]() {
+            run(trees[t], empty, team, start + budget);
+        });
+    }
+    run(trees[0], empty, team, start + budget);
+    for (std::thread& helper : helpers) {
+        helper.join();
+    }
+    elapsed = Timer::now() - start;
+
+    // Add up the playouts of each move over the trees
+    playouts = 0;
+    for (const Tree& tree : trees) {
+        playouts += tree.playouts;
+    }
+
+    Location best;
+    long unsigned most = 0;
+    win_rate = 0;
+    for (bits_t m = moves(empty, team); m != 0; m &= m - 1) {
+        const unsigned i = Bitboard::lowest(m);
+        const bits_t next = empty & ~domino(i, team);
+        long unsigned visits = 0;
+        long unsigned wins = 0;
+        for (const Tree& tree : trees) {
+            const std::uint32_t child = probe(tree, next, 1 - team);
+            if (child != NONE) {
+                visits += tree.nodes[child].visits;
+                wins += tree.nodes[child].wins;
+            }
+        }
+
+        if (best == Location() || visits > most) {
+            best = board.location(board.who, i);
+            most = visits;
+            win_rate = visits > 0 ? static_cast<float>(wins) / visits : 0;
+        }
+    }
+
+    timer.click();
+
+    return best;
+}
+
+void MctsSearcher::set_threads(const unsigned threads) {
+    num_threads = std::max(threads, 1u);
+    trees.clear();
+}
+
+void MctsSearcher::set_tree_size(const size_t megabytes) {
+    this->megabytes = megabytes;
+    trees.clear();
+}
+
+size_t MctsSearcher::get_nodes() const {
+    size_t nodes = 0;
+    for (const Tree& tree : trees) {
+        nodes += tree.nodes_used;
+    }
+    return nodes;
+}
+
+/* Private methods */
+
+void MctsSearcher::clear(Tree& tree) const {
+    if (tree.nodes.empty()) {
+        // Each node takes two slots of the table, so that it is at most
+        // half full, and room for eight children
+        const size_t per_node =
+            sizeof(TreeNode) + 2 * sizeof(std::uint32_t) + 8 * sizeof(Edge);
+        size_t count = 1;
+        while (count * 2 * per_node <= megabytes * 1024 * 1024) {
+            count *= 2;
+        }
+        tree.nodes.resize(count);
+        tree.edges.resize(count * 8);
+        tree.table.resize(count * 2);
+    }
+
+    std::fill(tree.table.begin(), tree.table.end(), NONE);
+    tree.nodes_used = 0;
+    tree.edges_used = 0;
+}
+
+void MctsSearcher::run(Tree& tree,
+                       const bits_t empty,
+                       const unsigned team,
+                       const double deadline) const {
+    const std::uint32_t root = find(tree, empty, team);
+    if (root == NONE) {
+        return;
+    }
+
+    do {
+        for (unsigned k = 0; k < CHECK_INTERVAL; k++) {
+            playout_once(tree, root);
+        }
+        tree.playouts += CHECK_INTERVAL;
+    } while (Timer::now() < deadline);
+}
+
+void MctsSearcher::playout_once(Tree& tree, const std::uint32_t root) const {
+    std::uint32_t path[MAX_PATH];
+    unsigned length = 0;
+    unsigned winner;
+
+    std::uint32_t id = root;
+    while (true) {
+        path[length++] = id;
+        TreeNode& node = tree.nodes[id];
+
+        if (!node.expanded) {
+            const unsigned children =
+                Bitboard::count(moves(node.empty, node.team));
+            if (node.visits + 1 < EXPAND_VISITS
+                    || tree.edges_used + children > tree.edges.size()) {
+                winner = play_out(tree, node.empty, node.team);
+                break;
+            }
+            expand(tree, node);
+        }
+        if (node.edge_count == 0) {
+            winner = 1 - node.team;
+            break;
+        }
+
+        Edge& edge = tree.edges[node.first_edge + select(tree, node)];
+        if (edge.child == NONE) {
+            const unsigned other = 1 - node.team;
+            const bits_t next = node.empty & ~domino(edge.grid, node.team);
+            edge.child = find(tree, next, other);
+            if (edge.child == NONE) {
+                winner = play_out(tree, next, other);
+                break;
+            }
+        }
+        id = edge.child;
+    }
+
+    for (unsigned k = 0; k < length; k++) {
+        TreeNode& node = tree.nodes[path[k]];
+        node.visits++;
+        node.wins += winner != node.team;
+    }
+}
+
+unsigned MctsSearcher::play_out(Tree& tree, bits_t empty, unsigned team)
+        const {
+    while (true) {
+        const bits_t mine = moves(empty, team);
+        if (mine == 0) {
+            return 1 - team;
+        }
+
+        unsigned i = pick(tree, mine);
+        if (playout == Playout::LIGHT) {
+            // Keep the move that costs the side to move the fewest of its
+            // own moves for those it takes from the opponent
+            const unsigned j = pick(tree, mine);
+            if (j != i) {
+                const bits_t a = empty & ~domino(i, team);
+                const bits_t b = empty & ~domino(j, team);
+                const int score_a = Bitboard::count(moves(a, team))
+                    - Bitboard::count(moves(a, 1 - team));
+                const int score_b = Bitboard::count(moves(b, team))
+                    - Bitboard::count(moves(b, 1 - team));
+                if (score_b > score_a) {
+                    i = j;
+                }
+            }
+        }
+
+        empty &= ~domino(i, team);
+        team = 1 - team;
+    }
+}
+
+void MctsSearcher::expand(Tree& tree, TreeNode& node) const {
+    node.first_edge = tree.edges_used;
+    node.edge_count = 0;
+    for (bits_t m = moves(node.empty, node.team); m != 0; m &= m - 1) {
+        Edge& edge = tree.edges[tree.edges_used++];
+        edge.child = NONE;
+        edge.grid = Bitboard::lowest(m);
+        node.edge_count++;
+    }
+    node.expanded = 1;
+}
+
+unsigned MctsSearcher::select(const Tree& tree, const TreeNode& node) const {
+    const float log_visits = std::log(static_cast<float>(
+        std::max<std::uint32_t>(node.visits, 1)));
+
+    // Children without playouts first, in the order of the moves
+    unsigned best = 0;
+    float best_value = -1;
+    for (unsigned k = 0; k < node.edge_count; k++) {
+        const Edge& edge = tree.edges[node.first_edge + k];
+        if (edge.child == NONE || tree.nodes[edge.child].visits == 0) {
+            return k;
+        }
+
+        const TreeNode& child = tree.nodes[edge.child];
+        const float visits = static_cast<float>(child.visits);
+        const float value = child.wins / visits
+            + EXPLORATION * std::sqrt(log_visits / visits);
+        if (value > best_value) {
+            best = k;
+            best_value = value;
+        }
+    }
+    return best;
+}
+
+std::uint32_t MctsSearcher::find(Tree& tree,
+                                 const bits_t empty,
+                                 const unsigned team) const {
+    const size_t s = slot(tree, empty, team);
+    if (tree.table[s] != NONE) {
+        return tree.table[s];
+    }
+    if (tree.nodes_used == tree.nodes.size()) {
+        return NONE;
+    }
+
+    const std::uint32_t id = tree.nodes_used++;
+    TreeNode& node = tree.nodes[id];
+    node.empty = empty;
+    node.visits = 0;
+    node.wins = 0;
+    node.first_edge = 0;
+    node.edge_count = 0;
+    node.team = team;
+    node.expanded = 0;
+    tree.table[s] = id;
+    return id;
+}
+
+std::uint32_t MctsSearcher::probe(const Tree& tree,
+                                  const bits_t empty,
+                                  const unsigned team) const {
+    if (tree.table.empty()) {
+        return NONE;
+    }
+    return tree.table[slot(tree, empty, team)];
+}
+
+size_t MctsSearcher::slot(const Tree& tree,
+                          const bits_t empty,
+                          const unsigned team) const {
+    bits_t h = empty ^ team;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+
+    // Linear probing, the table is never more than half full
+    const size_t mask = tree.table.size() - 1;
+    size_t s = h & mask;
+    while (tree.table[s] != NONE) {
+        const TreeNode& node = tree.nodes[tree.table[s]];
+        if (node.empty == empty && node.team == team) {
+            break;
+        }
+        s = (s + 1) & mask;
+    }
+    return s;
+}
+
+/* vim: tw=78:et:ts=4:sts=4:sw=4 */
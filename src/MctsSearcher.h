@@ -0,0 +1,295 @@
+#ifndef MCTS_SEARCHER_H_
+#define MCTS_SEARCHER_H_
+
+#include "Bitboard.h"
+#include "DomineeringState.h"
+#include "Location.h"
+#include "Timer.h"
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * Chooses moves with Monte Carlo Tree Search instead of alpha-beta: plays
+ * many games to the end with cheap random moves (playouts), and grows a
+ * tree of the positions they go through, picking the moves that have won
+ * the most playouts so far more and more often (UCT). It needs no
+ * evaluation and no depth. Positions are Bitboard masks, so boards have at
+ * most 64 grids.
+ *
+ * Like in EndgameSolver, a position is nothing but its empty grids and the
+ * side to move, and the nodes are kept in a table by them, so that a
+ * position reached by different orders of moves is one node that gathers
+ * the playouts of all of them. The statistics of a node are those of the
+ * position, not of the move that led to it.
+ *
+ * The nodes and their lists of children are taken from pools allocated
+ * once, and the tree is kept from one move to the next, where the position
+ * after the opponent's reply usually already has many playouts. It is
+ * cleared once the pools are half used.
+ *
+ * Each thread grows a tree of its own from the same position (root
+ * parallelization), and the playouts of the children of the root are added
+ * up over the trees to pick the move. The threads share nothing while they
+ * run.
+ */
+class MctsSearcher {
+public:
+    using bits_t = Bitboard::bits_t;
+
+    /**
+     * How playouts pick their moves.
+     *
+     * RANDOM: any legal move.
+     * LIGHT: the better of two random moves, the one that leaves the side
+     *        to move more moves compared to the opponent.
+     */
+    enum class Playout {
+        RANDOM,
+        LIGHT
+    };
+
+    /**
+     * Memory for the pools of each thread unless told otherwise.
+     */
+    static const size_t DEFAULT_MEGABYTES = 64;
+
+    /**
+     * Weight of the exploration term of UCT. Lower than the sqrt(2) of the
+     * textbook, which spreads the playouts too thin over the 50 or so
+     * moves of a Domineering position.
+     */
+    static constexpr float EXPLORATION = 0.5;
+
+    /**
+     * Playouts through a leaf before its children are added. Most leaves
+     * are never visited again, and would waste a list of children each.
+     */
+    static const unsigned EXPAND_VISITS = 2;
+
+    /**
+     * Playouts between two looks at the clock.
+     */
+    static const unsigned CHECK_INTERVAL = 64;
+
+    MctsSearcher();
+
+    /**
+     * Forgets the trees of the previous game.
+     */
+    void reset();
+
+    /**
+     * Runs playouts from the state until the time budget for the move runs
+     * out.
+     *
+     * \param[in] state the current state of the game.
+     *
+     * \return the move with the most playouts, Location() if there is no
+     *         legal move.
+     */
+    Location search(const DomineeringState& state);
+
+    /**
+     * Sets the number of threads, each with a tree of its own. Changing it
+     * forgets the trees.
+     */
+    void set_threads(const unsigned threads);
+
+    /**
+     * Sets a fixed number of seconds to spend on each move, 0 to divide the
+     * time left in the game among the moves that are left.
+     */
+    void set_move_time(const float seconds) { move_time = seconds; }
+
+    void set_playout(const Playout playout) { this->playout = playout; }
+
+    /**
+     * Changes the memory for the pools of each thread, and forgets the
+     * trees.
+     */
+    void set_tree_size(const size_t megabytes);
+
+    /**
+     * \return the number of playouts of the last call to search, by all
+     *         threads.
+     */
+    long unsigned get_playouts() const { return playouts; }
+
+    /**
+     * \return the number of playouts per second of the last call to search,
+     *         by all threads.
+     */
+    double get_playouts_per_second() const {
+        return elapsed > 0 ? playouts / elapsed : 0;
+    }
+
+    /**
+     * \return the number of nodes in the trees, by all threads.
+     */
+    size_t get_nodes() const;
+
+    /**
+     * \return the share of its playouts that the move of the last call to
+     *         search won.
+     */
+    float get_win_rate() const { return win_rate; }
+
+private:
+    /**
+     * A position of the tree. `wins' counts the playouts won by the team
+     * that moved into it, the one not to move.
+     */
+    struct TreeNode {
+        bits_t empty;
+        std::uint32_t visits;
+        std::uint32_t wins;
+        /* Index of the first child in the pool of edges */
+        std::uint32_t first_edge;
+        std::uint8_t edge_count;
+        std::uint8_t team;
+        std::uint8_t expanded;
+    };
+
+    /**
+     * A move from a node, and the node it leads to once that was added.
+     */
+    struct Edge {
+        std::uint32_t child;
+        std::uint8_t grid;
+    };
+
+    /**
+     * The pools and table of one thread.
+     */
+    struct Tree {
+        std::vector<TreeNode> nodes;
+        std::vector<Edge> edges;
+        /* Open addressing, node indices by empty grids and side to move */
+        std::vector<std::uint32_t> table;
+        size_t nodes_used = 0;
+        size_t edges_used = 0;
+        std::uint64_t rng = 0;
+        long unsigned playouts = 0;
+    };
+
+    static const std::uint32_t NONE = ~std::uint32_t(0);
+
+    /* Longest game, plus the root */
+    static const unsigned MAX_PATH = 33;
+
+    std::vector<Tree> trees;
+    unsigned num_threads = 1;
+    size_t megabytes = DEFAULT_MEGABYTES;
+    Playout playout = Playout::LIGHT;
+
+    Timer timer;
+    float move_time = 0;
+
+    /* Masks of the board being searched */
+    bits_t not_last_col = 0;
+    unsigned cols = 0;
+
+    long unsigned playouts = 0;
+    double elapsed = 0;
+    float win_rate = 0;
+
+    /**
+     * Allocates the pools of a tree, or clears them if they are there.
+     */
+    void clear(Tree& tree) const;
+
+    /**
+     * Runs playouts in the tree from the root until the deadline.
+     */
+    void run(Tree& tree,
+             const bits_t empty,
+             const unsigned team,
+             const double deadline) const;
+
+    /**
+     * Goes down the tree from the root by UCT, adds a node, plays the game
+     * out from there and counts the result in every node on the way.
+     */
+    void playout_once(Tree& tree, const std::uint32_t root) const;
+
+    /**
+     * Plays random moves to the end of the game.
+     *
+     * \return the team that wins, 0 for HOME and 1 for AWAY.
+     */
+    unsigned play_out(Tree& tree, bits_t empty, unsigned team) const;
+
+    /**
+     * Adds the list of children of a node.
+     */
+    void expand(Tree& tree, TreeNode& node) const;
+
+    /**
+     * \return the index of the child of the node picked by UCT.
+     */
+    unsigned select(const Tree& tree, const TreeNode& node) const;
+
+    /**
+     * \return the node of the position, added if it is not in the table,
+     *         NONE if it is not and the pool is full.
+     */
+    std::uint32_t find(Tree& tree, const bits_t empty, const unsigned team)
+        const;
+
+    /**
+     * \return the node of the position if it is in the table, NONE if not.
+     */
+    std::uint32_t probe(const Tree& tree,
+                        const bits_t empty,
+                        const unsigned team) const;
+
+    /**
+     * \return the slot of the table where the position is, or where it
+     *         would be added.
+     */
+    size_t slot(const Tree& tree, const bits_t empty, const unsigned team)
+        const;
+
+    /**
+     * \return the grids where the team can start a domino.
+     */
+    bits_t moves(const bits_t empty, const unsigned team) const {
+        return team == 0
+            ? empty & empty >> 1 & not_last_col
+            : empty & empty >> cols;
+    }
+
+    /**
+     * \return the grids covered by the domino of the team at grid i.
+     */
+    bits_t domino(const unsigned i, const unsigned team) const {
+        return (bits_t(1) << i) | (bits_t(1) << (i + (team == 0 ? 1 : cols)));
+    }
+
+    /**
+     * \return a random number, xorshift64*.
+     */
+    static std::uint64_t random(Tree& tree) {
+        tree.rng ^= tree.rng >> 12;
+        tree.rng ^= tree.rng << 25;
+        tree.rng ^= tree.rng >> 27;
+        return tree.rng * 0x2545f4914f6cdd1dULL;
+    }
+
+    /**
+     * \return the grid of a random set bit of the mask, which must not be
+     *         0.
+     */
+    static unsigned pick(Tree& tree, bits_t mask) {
+        const unsigned n = (random(tree) >> 32) * Bitboard::count(mask) >> 32;
+        for (unsigned k = 0; k < n; k++) {
+            mask &= mask - 1;
+        }
+        return Bitboard::lowest(mask);
+    }
+};
+
+#endif /* end of include guard */
+
+/* vim: tw=78:et:ts=4:sts=4:sw=4 */
@@ -14,14 +14,20 @@ Moderator::Moderator(const std::string& team_name)
 
 Moderator::Moderator(const Moderator& other)
     : team_name{other.team_name}
+    , engine{other.engine}
     , searcher{other.searcher}
+    , mcts{other.mcts}
+    , book{other.book}
     , GamePlayer(other.team_name, GAME_NAME)
 {
 }
 
 Moderator::Moderator(Moderator&& other)
     : team_name{std::move(other.team_name)}
+    , engine{other.engine}
     , searcher{std::move(other.searcher)}
+    , mcts{std::move(other.mcts)}
+    , book{std::move(other.book)}
     , GamePlayer(other.team_name, GAME_NAME)
 {
 }
@@ -31,25 +37,175 @@ Moderator::~Moderator() {
 
 Moderator& Moderator::operator=(const Moderator& other) {
     team_name = other.team_name;
+    engine = other.engine;
     searcher = other.searcher;
+    mcts = other.mcts;
+    book = other.book;
 
     return *this;
 }
 /* }}} */
 
 void Moderator::init() {
-    // Do nothing
+    Params params(std::string("config") + Params::separatorChar
+                  + "uccineers.txt");
+
+    if (params.isDefined("ENGINE")) {
+        engine = params.stringValue("ENGINE") == "MCTS"
+            ? Engine::MCTS
+            : Engine::ALPHA_BETA;
+    }
+
+    if (params.isDefined("MCTS_THREADS")) {
+        unsigned threads = params.intValue("MCTS_THREADS");
+        mcts.set_threads(threads > 0
+                         ? threads
+                         : std::thread::hardware_concurrency());
+    }
+
+    if (params.isDefined("MCTS_PLAYOUT")) {
+        mcts.set_playout(params.stringValue("MCTS_PLAYOUT") == "RANDOM"
+                         ? MctsSearcher::Playout::RANDOM
+                         : MctsSearcher::Playout::LIGHT);
+    }
+
+    if (params.isDefined("MCTS_MEGABYTES")) {
+        mcts.set_tree_size(params.intValue("MCTS_MEGABYTES"));
+    }
+
+    if (params.isDefined("SEARCH")) {
+        const std::string& search = params.stringValue("SEARCH");
+        if (search == "PVS") {
+            searcher.set_mode(Searcher::Mode::PVS);
+        }
+        else if (search == "MTDF") {
+            searcher.set_mode(Searcher::Mode::MTDF);
+        }
+        else if (search == "ALPHABETA") {
+            searcher.set_mode(Searcher::Mode::ALPHA_BETA);
+        }
+    }
+
+    if (params.isDefined("PARALLEL")) {
+        searcher.set_parallelism(params.stringValue("PARALLEL") == "YBWC"
+                                 ? Searcher::Parallelism::YBWC
+                                 : Searcher::Parallelism::LAZY_SMP);
+    }
+
+    if (params.isDefined("THREADS")) {
+        unsigned threads = params.intValue("THREADS");
+        searcher.set_threads(threads > 0
+                             ? threads
+                             : std::thread::hardware_concurrency());
+    }
+
+    if (params.isDefined("ASPIRATION_WINDOW")
+            && params.isDefined("ASPIRATION_GROWTH")) {
+        searcher.set_aspiration(params.intValue("ASPIRATION_WINDOW"),
+                                params.intValue("ASPIRATION_GROWTH"));
+    }
+
+    if (params.isDefined("TABLE_MEGABYTES")) {
+        searcher.set_table_size(params.intValue("TABLE_MEGABYTES"));
+    }
+
+    if (params.isDefined("REGIONS")) {
+        searcher.set_region_analysis(params.boolValue("REGIONS"));
+    }
+
+    if (params.isDefined("ENDGAME_EMPTY")
+            || params.isDefined("ENDGAME_MOVES")) {
+        searcher.set_endgame(params.isDefined("ENDGAME_EMPTY")
+                             ? params.intValue("ENDGAME_EMPTY") : 0,
+                             params.isDefined("ENDGAME_MOVES")
+                             ? params.intValue("ENDGAME_MOVES") : 0);
+    }
+
+    if (params.isDefined("DFPN_EMPTY")) {
+        searcher.set_dfpn(params.intValue("DFPN_EMPTY"));
+    }
+
+    if (params.isDefined("REGION_VALUES")) {
+        RegionDatabase& region_database = searcher.get_region_database();
+        region_database.open(params.stringValue("REGION_VALUES"));
+        std::cout << "Loaded " << region_database.size() << " region values"
+            << std::endl;
+    }
+
+    if (params.isDefined("PONDER")) {
+        searcher.set_pondering(params.boolValue("PONDER"));
+    }
+
+    if (params.isDefined("BOOK")) {
+        book->open(params.stringValue("BOOK"));
+        std::cout << "Loaded " << book->size() << " book positions"
+            << std::endl;
+    }
+
+    if (params.isDefined("SOLUTIONS")) {
+        SolutionCache& solutions = searcher.get_solutions();
+        solutions.open(params.stringValue("SOLUTIONS"));
+        std::cout << "Loaded " << solutions.size() << " solved positions"
+            << std::endl;
+    }
+}
+
+void Moderator::startGame(std::string opponent_name) {
+    searcher.reset();
+    mcts.reset();
+}
+
+void Moderator::endGame(int result) {
+    searcher.stop_pondering();
+    searcher.collect_solutions();
 }
 
 void Moderator::done() {
     searcher.cleanup();
+    searcher.collect_solutions();
+    searcher.get_solutions().save();
 }
 
 DomineeringMove Moderator::next_move(const DomineeringState& state) {
-    // Set the starting node
-    searcher.set_root(Node(state.getWho(), 0));
+    Location book_move;
+    if (book->probe(Bitboard(state), book_move)) {
+        // Nothing to ponder on, the reply is likely in the book too
+        searcher.stop_pondering();
+        std::cout << "Book move" << std::endl;
+        return book_move.to_move();
+    }
+
+    if (engine == Engine::MCTS) {
+        const Location move = mcts.search(state);
+        std::cout << "Ran " << mcts.get_playouts() << " playouts ("
+            << static_cast<long unsigned>(mcts.get_playouts_per_second())
+            << "/s), " << mcts.get_nodes() << " nodes, winning "
+            << static_cast<int>(mcts.get_win_rate() * 100) << "%"
+            << std::endl;
+        return move.to_move();
+    }
 
     Node best_child = searcher.search(state, get_search_depth(state));
+    if (searcher.get_endgame_solved()) {
+        std::cout << "Solved the endgame in " << searcher.get_nodes_searched()
+            << " nodes, winning with "
+            << best_child.parent_move.to_move().toString()
+            << std::endl;
+        return best_child.parent_move.to_move();
+    }
+    if (searcher.get_dfpn_solved()) {
+        std::cout << "Proved a win with df-pn, playing "
+            << best_child.parent_move.to_move().toString() << std::endl;
+        return best_child.parent_move.to_move();
+    }
+    std::cout << "Searched " << searcher.get_nodes_searched()
+        << " nodes, depth " << searcher.get_completed_depth()
+        << ", " << searcher.get_researches() << " re-searches"
+        << (searcher.get_ponder_hit() ? ", ponder hit" : "") << std::endl;
+
+    // Think about our next move while the opponent thinks about theirs
+    searcher.ponder(state, best_child, get_search_depth(state));
+
     return best_child.parent_move.to_move();
 }
 
@@ -61,28 +217,11 @@ GameMove* Moderator::getMove(GameState& state, const std::string& last_move) {
 /* Private methods */
 
 unsigned Moderator::get_search_depth(const DomineeringState& state) const {
-    unsigned game_moves = state.getNumMoves();
-    unsigned depth;
+    const std::vector<char>& board = *state.getBoard1D();
+    unsigned empty = std::count(board.begin(), board.end(), state.EMPTYSYM);
 
-    if (searcher.get_time_left() > TIME_LIMIT) {
-        // The first four moves are not worth searching deep
-        if (game_moves <= 4) {
-            depth = 4;
-        }
-        else if (game_moves >= 16) {
-            depth = 11;
-        }
-        else if (game_moves >= 14) {
-            depth = 8;
-        }
-        else {
-            depth = 6;
-        }
-    }
-    else {
-        depth = 4;
-    }
-    return depth;
+    // Every move covers two grids, so the game cannot last any longer
+    return empty / 2;
 }
 
 /* vim: tw=78:et:ts=4:sts=4:sw=4 */
@@ -1,14 +1,19 @@
 #ifndef MODERATOR_H_
 #define MODERATOR_H_
 
+#include "MctsSearcher.h"
+#include "OpeningBook.h"
 #include "Searcher.h"
 #include "TranspositionTable.h"
 
 #include "DomineeringMove.h"
 #include "GamePlayer.h"
+#include "Params.h"
 
 #include <algorithm>
 #include <fstream>
+#include <iostream>
+#include <memory>
 #include <string>
 
 /**
@@ -17,10 +22,21 @@
  */
 
 static const std::string GAME_NAME = "Domineering";
-static constexpr float TIME_LIMIT = 20;
 
 class Moderator : public GamePlayer {
 public:
+    /**
+     * The engine that picks the moves the book does not have.
+     *
+     * ALPHA_BETA: Searcher.
+     * MCTS: MctsSearcher, which needs no evaluation. Like the rest of the
+     *       player, it plays boards of up to 64 grids.
+     */
+    enum class Engine {
+        ALPHA_BETA,
+        MCTS
+    };
+
     // Default constructor
     Moderator();
 
@@ -44,17 +60,38 @@ public:
     Moderator& operator=(const Moderator& other);
 
     /**
-     * Reads in the file that contains the transposition table.
+     * Reads in the configuration of the searcher (config/uccineers.txt), and
+     * maps the opening book and the file of the positions solved in earlier
+     * runs.
      */
     void init() override;
 
     /**
-     * Does housekeeping stuff like joining threads.
+     * Starts the game with an empty transposition table, which is kept
+     * from then on until the game ends.
+     *
+     * \param[in] opponent_name the name of the opponent.
+     */
+    void startGame(std::string opponent_name) override;
+
+    /**
+     * Stops pondering, the expected reply will never come. Keeps the
+     * positions solved during the game before the transposition table is
+     * cleared for the next one.
+     *
+     * \param[in] result -1 if loss, 0 if draw, +1 if win.
+     */
+    void endGame(int result) override;
+
+    /**
+     * Does housekeeping stuff like joining threads, and saves the solved
+     * positions for the next run.
      */
     void done() override;
 
     /**
-     * Uses the searcher to get the next move.
+     * Plays the move of the opening book if the state is in it, and uses
+     * the engine of the configuration to get the next move otherwise.
      *
      * \param[in] last_move the last move made by the opponent.
      *
@@ -72,7 +109,8 @@ public:
 
 private:
     /**
-     * Determines the depth to search down to.
+     * Determines the depth that iterative deepening may go down to. How deep
+     * the search actually goes is decided by the time left.
      *
      * \param[in] state the current state of the game.
      *
@@ -81,7 +119,11 @@ private:
     unsigned get_search_depth(const DomineeringState& state) const;
 
     std::string team_name;
+    Engine engine = Engine::ALPHA_BETA;
     Searcher searcher;
+    MctsSearcher mcts;
+    /* Read-only, so copies share it */
+    std::shared_ptr<OpeningBook> book{std::make_shared<OpeningBook>()};
     DomineeringMove next_game_move;
 };
 
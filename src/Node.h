@@ -90,27 +90,10 @@ struct Node {
 
     /**
      * Changes the node to a terminal node.
-     * The score is updated depending on the status of the game (POS_INF if
-     * status is HOME_WIN, NEG_INF if AWAY_WIN).
-     *
-     * \param[in] state current state of the board. Passed in by value because
-     *                  the `DomineeringState::status' member variable needs
-     *                  to be updated first (due to how the library is
-     *                  currently implemented) in order for us to be able to
-     *                  get the status of the game.
-     */
-    void set_as_terminal(DomineeringState state);
-
-    /**
-     * Updates the lower limit and/or upper limit of the scores depending on
-     * how good the next move is.
-     * These limits are used in the transposition table to narrow down the
-     * range of scores that result from searching the children nodes.
-     *
-     * \param[in] next_move the next move (i.e. one of this node's children).
+     * The team of the node is to move and has no moves left, so it loses:
+     * the score is NEG_INF for HOME and POS_INF for AWAY.
      */
-    void update_limits(const Node& next_move);
-
+    void set_as_terminal();
 
     /* Team of this node. Min or Max. */
     Who team;
@@ -143,30 +126,9 @@ inline bool Node::is_terminal() const {
     return is_terminal_;
 }
 
-inline void Node::set_as_terminal(DomineeringState state) {
+inline void Node::set_as_terminal() {
     is_terminal_ = true;
-
-    // Update the DomineeringState::state variable
-    state.checkTerminalUpdateStatus();
-    // Now get the updated status
-    auto status = state.getStatus();
-    if (status == Status::HOME_WIN) {
-        set_score(AlphaBeta::POS_INF);
-    }
-    else if (status == Status::AWAY_WIN) {
-        set_score(AlphaBeta::NEG_INF);
-    }
-}
-
-inline void Node::update_limits(const Node& next_move) {
-    if (team == Who::HOME) {
-        lower_limit = std::max(next_move.lower_limit, lower_limit);
-        upper_limit = std::max(next_move.upper_limit, upper_limit);
-    }
-    else {
-        lower_limit = std::min(next_move.lower_limit, lower_limit);
-        upper_limit = std::min(next_move.upper_limit, upper_limit);
-    }
+    set_score(team == Who::HOME ? AlphaBeta::NEG_INF : AlphaBeta::POS_INF);
 }
 
 inline bool Node::operator<(const Node& other) const {
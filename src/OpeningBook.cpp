@@ -0,0 +1,132 @@
+#include "OpeningBook.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+const char OpeningBook::MAGIC[8] = {'U', 'C', 'C', 'B', 'O', 'O', 'K', '1'};
+
+OpeningBook::~OpeningBook() {
+    close();
+}
+
+bool OpeningBook::open(const std::string& path) {
+    close();
+
+    // Boards of the size in config/domineering.txt
+    const Bitboard board;
+    rows = board.rows;
+    cols = board.cols;
+
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0
+            || static_cast<size_t>(st.st_size) < sizeof(Header)) {
+        ::close(fd);
+        return false;
+    }
+
+    mapping_size = st.st_size;
+    mapping = mmap(nullptr, mapping_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        mapping = nullptr;
+        mapping_size = 0;
+        return false;
+    }
+
+    const Header* header = static_cast<const Header*>(mapping);
+    const size_t expected = sizeof(Header)
+        + header->count * (sizeof(std::uint64_t) + sizeof(Entry));
+    if (std::memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0
+            || header->rows != rows || header->cols != cols
+            || mapping_size != expected) {
+        close();
+        return false;
+    }
+
+    count = header->count;
+    keys = reinterpret_cast<const std::uint64_t*>(header + 1);
+    entries = reinterpret_cast<const Entry*>(keys + count);
+    return true;
+}
+
+bool OpeningBook::save(const std::string& path,
+                       const unsigned rows,
+                       const unsigned cols,
+                       std::vector<std::pair<std::uint64_t, Entry>> positions) {
+    std::sort(positions.begin(), positions.end(),
+              [](const std::pair<std::uint64_t, Entry>& a,
+                 const std::pair<std::uint64_t, Entry>& b) {
+              return a.first < b.first;
+              });
+
+    Header header;
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.rows = rows;
+    header.cols = cols;
+    header.count = positions.size();
+
+    const std::string temp_path = path + ".tmp";
+    {
+        std::ofstream ofs(temp_path, std::ios::binary | std::ios::trunc);
+        ofs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        for (const auto& position : positions) {
+            ofs.write(reinterpret_cast<const char*>(&position.first),
+                      sizeof(position.first));
+        }
+        for (const auto& position : positions) {
+            ofs.write(reinterpret_cast<const char*>(&position.second),
+                      sizeof(position.second));
+        }
+        if (!ofs) {
+            std::remove(temp_path.c_str());
+            return false;
+        }
+    }
+    if (std::rename(temp_path.c_str(), path.c_str()) != 0) {
+        std::remove(temp_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool OpeningBook::probe(const Bitboard& state, Location& move) const {
+    if (count == 0 || state.rows != rows || state.cols != cols) {
+        return false;
+    }
+
+    std::uint64_t key;
+    const unsigned symmetry = state.canonical(key);
+    const std::uint64_t* it = std::lower_bound(keys, keys + count, key);
+    if (it == keys + count || *it != key) {
+        return false;
+    }
+
+    move = state.restore_move(symmetry, entries[it - keys].move);
+    return state.legal(state.who, move);
+}
+
+/* Private methods */
+
+void OpeningBook::close() {
+    if (mapping) {
+        munmap(mapping, mapping_size);
+    }
+    mapping = nullptr;
+    mapping_size = 0;
+    keys = nullptr;
+    entries = nullptr;
+    count = 0;
+}
+
+/* vim: tw=78:et:ts=4:sts=4:sw=4 */
@@ -0,0 +1,121 @@
+#ifndef OPENING_BOOK_H_
+#define OPENING_BOOK_H_
+
+#include "Bitboard.h"
+#include "Evaluators.h"
+#include "Location.h"
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * Moves for the first plies of the game, searched ahead of time far deeper
+ * than a game leaves time for (see tools/book.cpp).
+ *
+ * The file holds a header, the keys of the positions in ascending order, and
+ * one OpeningBook::Entry per position, all as seen through the symmetry that
+ * gave the key (see Bitboard::canonical). Like SolutionCache, it is mapped
+ * into memory read-only and searched by bisection.
+ */
+class OpeningBook {
+public:
+    /**
+     * What the search found for a position. `move' is the grid the best
+     * move starts at, and `score' its score when searched `depth' plies
+     * deep, for HOME as in the rest of the searcher.
+     */
+    struct Entry {
+        std::int32_t score;
+        std::uint8_t depth;
+        std::uint8_t move;
+        std::uint16_t reserved;
+    };
+
+    OpeningBook() = default;
+
+    OpeningBook(const OpeningBook& other) = delete;
+
+    ~OpeningBook();
+
+    OpeningBook& operator=(const OpeningBook& other) = delete;
+
+    /**
+     * Maps the file into memory. A missing file, or one for another board
+     * size, leaves the book empty.
+     *
+     * \param[in] path the path of the file.
+     *
+     * \return true if the file was read.
+     */
+    bool open(const std::string& path);
+
+    /**
+     * Writes a book.
+     *
+     * \param[in] path the path of the file. Written next to it first and
+     *                 moved over it, so a player that has it mapped keeps
+     *                 reading the old one.
+     *
+     * \param[in] rows the number of rows of the boards.
+     *
+     * \param[in] cols the number of columns of the boards.
+     *
+     * \param[in] positions the key and entry of each position, in any order
+     *                      and without duplicates.
+     *
+     * \return true if the file was written.
+     */
+    static bool save(const std::string& path,
+                     const unsigned rows,
+                     const unsigned cols,
+                     std::vector<std::pair<std::uint64_t, Entry>> positions);
+
+    /**
+     * Looks a position up. Safe to call from multiple threads at the same
+     * time.
+     *
+     * \param[in] state the position.
+     *
+     * \param[out] move the best move for the side to move.
+     *
+     * \return true if the position is in the book.
+     */
+    bool probe(const Bitboard& state, Location& move) const;
+
+    /**
+     * \return the number of positions in the book.
+     */
+    size_t size() const { return count; }
+
+private:
+    struct Header {
+        char magic[8];
+        std::uint32_t rows, cols;
+        std::uint64_t count;
+    };
+
+    /* Identifies the file and the version of its format */
+    static const char MAGIC[8];
+
+    unsigned rows = 0, cols = 0;
+
+    /* The file mapped into memory */
+    void* mapping = nullptr;
+    size_t mapping_size = 0;
+
+    /* The positions of the file */
+    const std::uint64_t* keys = nullptr;
+    const Entry* entries = nullptr;
+    size_t count = 0;
+
+    /**
+     * Unmaps the file.
+     */
+    void close();
+};
+
+#endif /* end of include guard */
+
+/* vim: tw=78:et:ts=4:sts=4:sw=4 */
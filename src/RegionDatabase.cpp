@@ -0,0 +1,190 @@
+#include "RegionDatabase.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+const char RegionDatabase::MAGIC[8] = {'U', 'C', 'C', 'C', 'G', 'T', 'V', '1'};
+
+RegionDatabase::~RegionDatabase() {
+    close();
+}
+
+bool RegionDatabase::open(const std::string& path) {
+    close();
+
+    // Boards of the size in config/domineering.txt
+    const Bitboard board;
+    rows = board.rows;
+    cols = board.cols;
+
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0
+            || static_cast<size_t>(st.st_size) < sizeof(Header)) {
+        ::close(fd);
+        return false;
+    }
+
+    mapping_size = st.st_size;
+    mapping = mmap(nullptr, mapping_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        mapping = nullptr;
+        mapping_size = 0;
+        return false;
+    }
+
+    const Header* header = static_cast<const Header*>(mapping);
+    const size_t expected = sizeof(Header)
+        + header->count * (sizeof(std::uint64_t) + sizeof(std::uint32_t))
+        + header->game_count * sizeof(Game)
+        + header->option_count * sizeof(std::uint32_t);
+    if (std::memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0
+            || header->rows != rows || header->cols != cols
+            || mapping_size != expected) {
+        close();
+        return false;
+    }
+
+    count = header->count;
+    shapes = reinterpret_cast<const std::uint64_t*>(header + 1);
+    shape_games = reinterpret_cast<const std::uint32_t*>(shapes + count);
+    games = reinterpret_cast<const Game*>(shape_games + count);
+    options = reinterpret_cast<const std::uint32_t*>(games
+                                                     + header->game_count);
+    return true;
+}
+
+bool RegionDatabase::save(const std::string& path,
+                          const unsigned rows,
+                          const unsigned cols,
+                          const GameValues& values,
+                          std::vector<std::pair<bits_t, id_t>> shapes) {
+    std::sort(shapes.begin(), shapes.end());
+
+    // Only the games the shapes are worth and their options are written.
+    // Options come before the games they belong to in `values', so the
+    // order of the numbers is kept.
+    std::vector<bool> needed(values.size(), false);
+    std::vector<id_t> stack;
+    for (const auto& shape : shapes) {
+        stack.push_back(shape.second);
+    }
+    while (!stack.empty()) {
+        const id_t g = stack.back();
+        stack.pop_back();
+        if (needed[g]) {
+            continue;
+        }
+        needed[g] = true;
+        stack.insert(stack.end(), values.left(g).begin(),
+                     values.left(g).end());
+        stack.insert(stack.end(), values.right(g).begin(),
+                     values.right(g).end());
+    }
+
+    std::vector<id_t> numbers(values.size());
+    std::vector<Game> games;
+    std::vector<std::uint32_t> options;
+    for (id_t g = 0; g < values.size(); g++) {
+        if (!needed[g]) {
+            continue;
+        }
+        numbers[g] = games.size();
+        Game game;
+        game.first = options.size();
+        game.left = values.left(g).size();
+        game.right = values.right(g).size();
+        for (const id_t option : values.left(g)) {
+            options.push_back(numbers[option]);
+        }
+        for (const id_t option : values.right(g)) {
+            options.push_back(numbers[option]);
+        }
+        games.push_back(game);
+    }
+
+    Header header;
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.rows = rows;
+    header.cols = cols;
+    header.count = shapes.size();
+    header.game_count = games.size();
+    header.option_count = options.size();
+
+    const std::string temp_path = path + ".tmp";
+    {
+        std::ofstream ofs(temp_path, std::ios::binary | std::ios::trunc);
+        ofs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        for (const auto& shape : shapes) {
+            ofs.write(reinterpret_cast<const char*>(&shape.first),
+                      sizeof(shape.first));
+        }
+        for (const auto& shape : shapes) {
+            const std::uint32_t game = numbers[shape.second];
+            ofs.write(reinterpret_cast<const char*>(&game), sizeof(game));
+        }
+        ofs.write(reinterpret_cast<const char*>(games.data()),
+                  games.size() * sizeof(Game));
+        ofs.write(reinterpret_cast<const char*>(options.data()),
+                  options.size() * sizeof(std::uint32_t));
+        if (!ofs) {
+            std::remove(temp_path.c_str());
+            return false;
+        }
+    }
+    if (std::rename(temp_path.c_str(), path.c_str()) != 0) {
+        std::remove(temp_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool RegionDatabase::find(const bits_t shape, id_t& game) const {
+    const std::uint64_t* it = std::lower_bound(shapes, shapes + count, shape);
+    if (it == shapes + count || *it != shape) {
+        return false;
+    }
+    game = shape_games[it - shapes];
+    return true;
+}
+
+std::vector<RegionDatabase::id_t>
+RegionDatabase::left(const id_t game) const {
+    const Game& g = games[game];
+    return std::vector<id_t>(options + g.first, options + g.first + g.left);
+}
+
+std::vector<RegionDatabase::id_t>
+RegionDatabase::right(const id_t game) const {
+    const Game& g = games[game];
+    const std::uint32_t* begin = options + g.first + g.left;
+    return std::vector<id_t>(begin, begin + g.right);
+}
+
+/* Private methods */
+
+void RegionDatabase::close() {
+    if (mapping) {
+        munmap(mapping, mapping_size);
+    }
+    mapping = nullptr;
+    mapping_size = 0;
+    shapes = nullptr;
+    shape_games = nullptr;
+    games = nullptr;
+    options = nullptr;
+    count = 0;
+}
+
+/* vim: tw=78:et:ts=4:sts=4:sw=4 */
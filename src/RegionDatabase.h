@@ -0,0 +1,132 @@
+#ifndef REGION_DATABASE_H_
+#define REGION_DATABASE_H_
+
+#include "Bitboard.h"
+#include "GameValues.h"
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * The values of regions computed ahead of time (see tools/regiondb.cpp),
+ * by the shape of the region (see Regions::shape).
+ *
+ * The file holds a header, the shapes in ascending order, the game each
+ * shape is worth, and the games themselves, each one after its options.
+ * Like SolutionCache, it is mapped into memory read-only and searched by
+ * bisection. The games are copied into a GameValues when they are needed.
+ */
+class RegionDatabase {
+public:
+    using bits_t = Bitboard::bits_t;
+    using id_t = GameValues::id_t;
+
+    RegionDatabase() = default;
+
+    RegionDatabase(const RegionDatabase& other) = delete;
+
+    ~RegionDatabase();
+
+    RegionDatabase& operator=(const RegionDatabase& other) = delete;
+
+    /**
+     * Maps the file into memory. A missing file, or one for another board
+     * size, leaves the database empty.
+     *
+     * \param[in] path the path of the file.
+     *
+     * \return true if the file was read.
+     */
+    bool open(const std::string& path);
+
+    /**
+     * Writes a database.
+     *
+     * \param[in] path the path of the file.
+     *
+     * \param[in] rows the number of rows of the boards.
+     *
+     * \param[in] cols the number of columns of the boards.
+     *
+     * \param[in] values the games the shapes are worth.
+     *
+     * \param[in] shapes each shape and the game in `values' it is worth,
+     *                   in any order and without duplicates.
+     *
+     * \return true if the file was written.
+     */
+    static bool save(const std::string& path,
+                     const unsigned rows,
+                     const unsigned cols,
+                     const GameValues& values,
+                     std::vector<std::pair<bits_t, id_t>> shapes);
+
+    /**
+     * Looks a shape up.
+     *
+     * \param[in] shape the shape.
+     *
+     * \param[out] game the game it is worth, as numbered in the file.
+     *
+     * \return true if the shape is in the database.
+     */
+    bool find(const bits_t shape, id_t& game) const;
+
+    /**
+     * \return the left options of a game of the file.
+     */
+    std::vector<id_t> left(const id_t game) const;
+
+    /**
+     * \return the right options of a game of the file.
+     */
+    std::vector<id_t> right(const id_t game) const;
+
+    /**
+     * \return the number of shapes in the database.
+     */
+    size_t size() const { return count; }
+
+private:
+    struct Header {
+        char magic[8];
+        std::uint32_t rows, cols;
+        std::uint64_t count;
+        std::uint64_t game_count;
+        std::uint64_t option_count;
+    };
+
+    /* A game: its left options, then its right ones, from `first' on */
+    struct Game {
+        std::uint32_t first;
+        std::uint16_t left;
+        std::uint16_t right;
+    };
+
+    /* Identifies the file and the version of its format */
+    static const char MAGIC[8];
+
+    unsigned rows = 0, cols = 0;
+
+    /* The file mapped into memory */
+    void* mapping = nullptr;
+    size_t mapping_size = 0;
+
+    const std::uint64_t* shapes = nullptr;
+    const std::uint32_t* shape_games = nullptr;
+    size_t count = 0;
+
+    const Game* games = nullptr;
+    const std::uint32_t* options = nullptr;
+
+    /**
+     * Unmaps the file.
+     */
+    void close();
+};
+
+#endif /* end of include guard */
+
+/* vim: tw=78:et:ts=4:sts=4:sw=4 */
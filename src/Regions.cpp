@@ -0,0 +1,263 @@
+#include "Regions.h"
+
+#include <algorithm>
+
+std::vector<Regions::bits_t> Regions::split(const Bitboard& board) {
+    std::vector<bits_t> regions;
+    for (bits_t left = live(board, board.empty()); left != 0; ) {
+        regions.push_back(next(board, left));
+    }
+    return regions;
+}
+
+Regions::Outcome Regions::outcome(const Bitboard& board,
+                                  const bits_t region) {
+    const bits_t home_moves = region & region >> 1 & board.not_last_column();
+    const bits_t away_moves = region & region >> board.cols;
+
+    // The team that can move has as many moves as it has places, and the
+    // other can never take them
+    if (away_moves == 0) {
+        return home_moves == 0 ? Outcome::SECOND : Outcome::HOME;
+    }
+    if (home_moves == 0) {
+        return Outcome::AWAY;
+    }
+    if (Bitboard::count(region) > MAX_GRIDS) {
+        return Outcome::UNKNOWN;
+    }
+
+    const bits_t key = shape(board, region);
+    const auto found = outcomes.find(key);
+    if (found != outcomes.end()) {
+        return found->second;
+    }
+
+    const bool home_first = wins(board, key, Who::HOME);
+    const bool away_first = wins(board, key, Who::AWAY);
+    const Outcome result = home_first
+        ? (away_first ? Outcome::FIRST : Outcome::HOME)
+        : (away_first ? Outcome::AWAY : Outcome::SECOND);
+    outcomes[key] = result;
+    return result;
+}
+
+bool Regions::decide(const Bitboard& board, Who& winner) {
+    trim_values();
+
+    bool home = false;
+    bool away = false;
+    unsigned first = 0;
+    id_t sum = GameValues::ZERO;
+
+    // Stops at the first region that is too large to tell
+    for (bits_t left = live(board, board.empty()); left != 0; ) {
+        const bits_t region = next(board, left);
+        const id_t v = region_value(board, region, false);
+        if (v != NO_VALUE) {
+            sum = values.add(sum, v);
+            continue;
+        }
+
+        switch (outcome(board, region)) {
+        case Outcome::HOME:
+            home = true;
+            break;
+        case Outcome::AWAY:
+            away = true;
+            break;
+        case Outcome::FIRST:
+            first++;
+            break;
+        case Outcome::SECOND:
+            break;
+        case Outcome::UNKNOWN:
+            return false;
+        }
+    }
+
+    switch (values.sign(sum)) {
+    case GameValues::Sign::POSITIVE:
+        home = true;
+        break;
+    case GameValues::Sign::NEGATIVE:
+        away = true;
+        break;
+    case GameValues::Sign::FUZZY:
+        first++;
+        break;
+    case GameValues::Sign::ZERO:
+        break;
+    }
+
+    // Regions the second player wins add nothing. What is left is won by
+    // the first player if it is one region of that kind, and by a team if
+    // it is all regions that team wins.
+    if (first == 0 && home != away) {
+        winner = home ? Who::HOME : Who::AWAY;
+        return true;
+    }
+    if (!home && !away && first <= 1) {
+        const Who other = board.who == Who::HOME ? Who::AWAY : Who::HOME;
+        winner = first == 1 ? board.who : other;
+        return true;
+    }
+    return false;
+}
+
+Regions::id_t Regions::value(const Bitboard& board, const bits_t empty) {
+    id_t sum = GameValues::ZERO;
+    for (bits_t left = live(board, empty); left != 0; ) {
+        sum = values.add(sum, region_value(board, next(board, left), true));
+    }
+    return sum;
+}
+
+void Regions::set_database(const RegionDatabase* database) {
+    this->database = database;
+    imported.clear();
+    shape_values.clear();
+}
+
+Regions::bits_t Regions::live(const Bitboard& board, const bits_t empty) {
+    return empty & ((empty << 1 & board.not_first_column())
+                    | (empty >> 1 & board.not_last_column())
+                    | empty << board.cols
+                    | empty >> board.cols);
+}
+
+Regions::bits_t Regions::next(const Bitboard& board, bits_t& left) {
+    // Grow the region from its lowest grid until it stops growing
+    bits_t region = left & (~left + 1);
+    while (true) {
+        const bits_t grown = left & (region
+                                     | (region << 1
+                                        & board.not_first_column())
+                                     | (region >> 1
+                                        & board.not_last_column())
+                                     | region << board.cols
+                                     | region >> board.cols);
+        if (grown == region) {
+            break;
+        }
+        region = grown;
+    }
+
+    left &= ~region;
+    return region;
+}
+
+Regions::bits_t Regions::shape(const Bitboard& board, const bits_t region) {
+    bits_t best = ~bits_t(0);
+
+    // Mirror images only, swapping rows and columns swaps the teams
+    for (unsigned s = 0; s < Bitboard::SYMMETRIES / 2; s++) {
+        bits_t mirrored = 0;
+        unsigned min_col = board.cols;
+        for (bits_t grids = region; grids != 0; grids &= grids - 1) {
+            const unsigned i = board.transform(s, Bitboard::lowest(grids));
+            mirrored |= bits_t(1) << i;
+            min_col = std::min(min_col, i % board.cols);
+        }
+
+        const unsigned min_row = Bitboard::lowest(mirrored) / board.cols;
+        best = std::min(best, mirrored >> (min_row * board.cols + min_col));
+    }
+
+    return best;
+}
+
+/* Private methods */
+
+Regions::id_t Regions::region_value(const Bitboard& board,
+                                    const bits_t region,
+                                    const bool solve) {
+    const bits_t home_moves = region & region >> 1 & board.not_last_column();
+    const bits_t away_moves = region & region >> board.cols;
+
+    // A region only one team can move in is a row or a column, where that
+    // team has one move for every two grids
+    if (away_moves == 0) {
+        return values.integer(Bitboard::count(region) / 2);
+    }
+    if (home_moves == 0) {
+        return values.integer(-static_cast<int>(Bitboard::count(region) / 2));
+    }
+
+    const bits_t key = shape(board, region);
+    const auto found = shape_values.find(key);
+    if (found != shape_values.end()) {
+        return found->second;
+    }
+
+    id_t game;
+    id_t result = NO_VALUE;
+    if (database && database->find(key, game)) {
+        result = values.copy(game,
+                             [this](const id_t g) { return database->left(g); },
+                             [this](const id_t g) { return database->right(g); },
+                             imported);
+    } else if (solve) {
+        std::vector<id_t> left, right;
+        for (bits_t moves = key & key >> 1 & board.not_last_column();
+                moves != 0; moves &= moves - 1) {
+            const bits_t domino = board.domino(Who::HOME,
+                                               Bitboard::lowest(moves));
+            left.push_back(value(board, key & ~domino));
+        }
+        for (bits_t moves = key & key >> board.cols;
+                moves != 0; moves &= moves - 1) {
+            const bits_t domino = board.domino(Who::AWAY,
+                                               Bitboard::lowest(moves));
+            right.push_back(value(board, key & ~domino));
+        }
+        result = values.game(left, right);
+    } else {
+        return NO_VALUE;
+    }
+
+    shape_values[key] = result;
+    return result;
+}
+
+void Regions::trim_values() {
+    if (values.size() < MAX_VALUES) {
+        return;
+    }
+    values = GameValues();
+    shape_values.clear();
+    imported.clear();
+}
+
+bool Regions::wins(const Bitboard& board,
+                   const bits_t empty,
+                   const Who team) {
+    const unsigned t = team == Who::HOME ? 0 : 1;
+    bits_t moves = team == Who::HOME
+        ? empty & empty >> 1 & board.not_last_column()
+        : empty & empty >> board.cols;
+    if (moves == 0) {
+        return false;
+    }
+
+    const auto found = memo[t].find(empty);
+    if (found != memo[t].end()) {
+        return found->second;
+    }
+
+    const Who other = team == Who::HOME ? Who::AWAY : Who::HOME;
+    bool result = false;
+    for (; moves != 0 && !result; moves &= moves - 1) {
+        const unsigned i = Bitboard::lowest(moves);
+        result = !wins(board, empty & ~board.domino(team, i), other);
+    }
+
+    if (memo[t].size() >= MAX_MEMO) {
+        memo[0].clear();
+        memo[1].clear();
+    }
+    memo[t][empty] = result;
+    return result;
+}
+
+/* vim: tw=78:et:ts=4:sts=4:sw=4 */
@@ -0,0 +1,188 @@
+#ifndef REGIONS_H_
+#define REGIONS_H_
+
+#include "Bitboard.h"
+#include "GameValues.h"
+#include "RegionDatabase.h"
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Splits the empty grids of a board into regions that do not touch, and
+ * decides the game from them when it can.
+ *
+ * A domino always lies within one region, so the regions are separate
+ * games, and the board is their sum. The outcome of a sum is not known from
+ * the outcomes of its parts in general, but it is when the parts that are
+ * not won by the second player all go to the same team: a region that HOME
+ * wins whoever starts is worth more than nothing to HOME, and so is any sum
+ * of such regions and regions where the second player wins.
+ *
+ * The outcome of a region is known without searching when only one team
+ * can move in it, and found by solving the region on its own otherwise, if
+ * it is small enough. Solved regions are kept by shape.
+ *
+ * The value of a region (see GameValues) says more than its outcome: values
+ * add up, and the sign of the sum decides any set of regions. Regions only
+ * one team can move in are integers, and the values of other shapes come
+ * from a RegionDatabase computed ahead of time, when there is one. The
+ * regions with a known value are added up and the sum is taken as one more
+ * region.
+ */
+class Regions {
+public:
+    using bits_t = Bitboard::bits_t;
+    using id_t = GameValues::id_t;
+
+    /**
+     * Who wins a region: HOME or AWAY whoever starts, the second player
+     * (it is worth nothing), or the first player.
+     */
+    enum class Outcome : std::uint8_t {
+        HOME,
+        AWAY,
+        SECOND,
+        FIRST,
+        UNKNOWN
+    };
+
+    /**
+     * Largest region that is solved, in grids.
+     */
+    static const unsigned MAX_GRIDS = 20;
+
+    /**
+     * Number of boards remembered by Regions::wins before they are
+     * forgotten.
+     */
+    static const size_t MAX_MEMO = 1 << 20;
+
+    /**
+     * Number of games in the GameValues before they are forgotten.
+     */
+    static const size_t MAX_VALUES = 1 << 20;
+
+    /**
+     * \return the regions of the board: the sets of empty grids connected
+     *         through neighbouring empty grids. Grids with no empty
+     *         neighbour, where no domino can ever go, are left out.
+     */
+    static std::vector<bits_t> split(const Bitboard& board);
+
+    /**
+     * \param[in] board the board the region is on.
+     *
+     * \param[in] region the grids of the region.
+     *
+     * \return who wins the region, UNKNOWN if it is too large to tell.
+     */
+    Outcome outcome(const Bitboard& board, const bits_t region);
+
+    /**
+     * Tells which team wins the game, if the outcomes of the regions are
+     * enough to tell.
+     *
+     * \param[in] board the board.
+     *
+     * \param[out] winner the team that wins.
+     *
+     * \return true if the winner is known.
+     */
+    bool decide(const Bitboard& board, Who& winner);
+
+    /**
+     * Computes the value of some empty grids, solving every region of
+     * them whose value is not known yet, however large.
+     *
+     * \param[in] board the board the grids are on.
+     *
+     * \param[in] empty the empty grids.
+     *
+     * \return the value, in get_values().
+     */
+    id_t value(const Bitboard& board, const bits_t empty);
+
+    /**
+     * Looks values up in a database when they are not known. The database
+     * must outlive this.
+     */
+    void set_database(const RegionDatabase* database);
+
+    GameValues& get_values() { return values; }
+
+    /**
+     * \return the empty grids among the given ones that are next to another
+     *         one.
+     */
+    static bits_t live(const Bitboard& board, const bits_t empty);
+
+    /**
+     * Takes the region of the lowest grid out of the given grids.
+     *
+     * \param[in] board the board the grids are on.
+     *
+     * \param[in,out] left the grids that are not in a region yet.
+     *
+     * \return the grids of the region.
+     */
+    static bits_t next(const Bitboard& board, bits_t& left);
+
+    /**
+     * \return the grids of the region mirrored and moved to the top left
+     *         corner of the board, whichever way of mirroring gives the
+     *         lowest value, so that a region has the same shape wherever it
+     *         is.
+     */
+    static bits_t shape(const Bitboard& board, const bits_t region);
+
+private:
+    /* What Regions::region_value returns for a value it does not know */
+    static const id_t NO_VALUE = GameValues::NOT_COPIED;
+
+    /* The outcomes of the regions solved so far, by Regions::shape */
+    std::unordered_map<bits_t, Outcome> outcomes;
+
+    /* Whether the team to move wins, by empty grids, for each team */
+    std::unordered_map<bits_t, bool> memo[2];
+
+    GameValues values;
+
+    /* The values of the regions known so far, by Regions::shape */
+    std::unordered_map<bits_t, id_t> shape_values;
+
+    const RegionDatabase* database = nullptr;
+
+    /* The games of the database copied into `values', by their number there */
+    std::vector<id_t> imported;
+
+    /**
+     * \param[in] board the board the region is on.
+     *
+     * \param[in] region the grids of the region.
+     *
+     * \param[in] solve whether to compute the value if it is not known.
+     *
+     * \return the value of the region, NO_VALUE if it is not known and not
+     *         computed.
+     */
+    id_t region_value(const Bitboard& board,
+                      const bits_t region,
+                      const bool solve);
+
+    /**
+     * Forgets the values once there are too many of them.
+     */
+    void trim_values();
+
+    /**
+     * \return true if the team to move wins when only the given grids are
+     *         empty.
+     */
+    bool wins(const Bitboard& board, const bits_t empty, const Who team);
+};
+
+#endif /* end of include guard */
+
+/* vim: tw=78:et:ts=4:sts=4:sw=4 */
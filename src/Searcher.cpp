@@ -1,21 +1,49 @@
 #include "Searcher.h"
 
 /* Constructors, destructor, and assignment operator {{{ */
-Searcher::Searcher() {
+Searcher::Searcher()
+    : tp_table{std::make_shared<TranspositionTable>()}
+    , solutions{std::make_shared<SolutionCache>()}
+    , region_database{std::make_shared<RegionDatabase>()}
+{
     timer = Timer(240);
+    regions.set_database(region_database.get());
 }
 
-Searcher::Searcher(std::ifstream& ifs) {
+Searcher::Searcher(const std::shared_ptr<TranspositionTable>& table,
+                   const std::shared_ptr<SolutionCache>& solutions,
+                   const std::shared_ptr<RegionDatabase>& region_database)
+    : tp_table{table}
+    , solutions{solutions}
+    , region_database{region_database}
+{
     timer = Timer(240);
+    regions.set_database(region_database.get());
 }
 
 Searcher::Searcher(const Searcher& other)
     : root{other.root}
     , best_moves{other.best_moves}
     , ordered_moves{other.ordered_moves}
-    , tp_table{other.tp_table}
+    , tp_table{std::make_shared<TranspositionTable>(*other.tp_table)}
+    , solutions{other.solutions}
+    , region_database{other.region_database}
     , timer{other.timer}
+    , mode{other.mode}
+    , aspiration_window{other.aspiration_window}
+    , aspiration_growth{other.aspiration_growth}
+    , num_threads{other.num_threads}
+    , move_time{other.move_time}
+    , parallelism{other.parallelism}
+    , pondering{other.pondering}
+    , move_ordering{other.move_ordering}
+    , region_analysis{other.region_analysis}
+    , endgame{other.endgame}
+    , endgame_max_empty{other.endgame_max_empty}
+    , endgame_max_moves{other.endgame_max_moves}
+    , dfpn_max_empty{other.dfpn_max_empty}
 {
+    regions.set_database(region_database.get());
 }
 
 Searcher::Searcher(Searcher&& other)
@@ -23,19 +51,54 @@ Searcher::Searcher(Searcher&& other)
     , best_moves{std::move(other.best_moves)}
     , ordered_moves{std::move(other.ordered_moves)}
     , tp_table{std::move(other.tp_table)}
+    , solutions{std::move(other.solutions)}
+    , region_database{std::move(other.region_database)}
     , timer{std::move(other.timer)}
+    , mode{other.mode}
+    , aspiration_window{other.aspiration_window}
+    , aspiration_growth{other.aspiration_growth}
+    , num_threads{other.num_threads}
+    , move_time{other.move_time}
+    , parallelism{other.parallelism}
+    , pondering{other.pondering}
+    , move_ordering{other.move_ordering}
+    , region_analysis{other.region_analysis}
+    , endgame{std::move(other.endgame)}
+    , endgame_max_empty{other.endgame_max_empty}
+    , endgame_max_moves{other.endgame_max_moves}
+    , dfpn{std::move(other.dfpn)}
+    , dfpn_max_empty{other.dfpn_max_empty}
 {
+    regions.set_database(region_database.get());
 }
 
 Searcher::~Searcher() {
+    stop_pondering();
+    stop_helpers();
 }
 
 Searcher& Searcher::operator=(const Searcher& other) {
     root = other.root;
     best_moves = other.best_moves;
     ordered_moves = other.ordered_moves;
-    tp_table = other.tp_table;
+    *tp_table = *other.tp_table;
+    solutions = other.solutions;
+    region_database = other.region_database;
+    regions.set_database(region_database.get());
     timer = other.timer;
+    mode = other.mode;
+    aspiration_window = other.aspiration_window;
+    aspiration_growth = other.aspiration_growth;
+    set_threads(other.num_threads);
+    move_time = other.move_time;
+    parallelism = other.parallelism;
+    pondering = other.pondering;
+    move_ordering = other.move_ordering;
+    region_analysis = other.region_analysis;
+    endgame = other.endgame;
+    endgame_max_empty = other.endgame_max_empty;
+    endgame_max_moves = other.endgame_max_moves;
+    dfpn_max_empty = other.dfpn_max_empty;
 
     return *this;
 }
@@ -44,47 +107,304 @@ Searcher& Searcher::operator=(Searcher&& other) {
     root = std::move(other.root);
     best_moves = std::move(other.best_moves);
     ordered_moves = std::move(other.ordered_moves);
-    tp_table = std::move(other.tp_table);
+    *tp_table = std::move(*other.tp_table);
+    solutions = std::move(other.solutions);
+    region_database = std::move(other.region_database);
+    regions.set_database(region_database.get());
     timer = std::move(other.timer);
+    mode = other.mode;
+    aspiration_window = other.aspiration_window;
+    aspiration_growth = other.aspiration_growth;
+    set_threads(other.num_threads);
+    move_time = other.move_time;
+    parallelism = other.parallelism;
+    pondering = other.pondering;
+    move_ordering = other.move_ordering;
+    region_analysis = other.region_analysis;
+    endgame = std::move(other.endgame);
+    endgame_max_empty = other.endgame_max_empty;
+    endgame_max_moves = other.endgame_max_moves;
+    dfpn = std::move(other.dfpn);
+    dfpn_max_empty = other.dfpn_max_empty;
 
     return *this;
 }
 /* }}} */
 
 void Searcher::reset() {
-    tp_table.clear();
+    stop_pondering();
+    tp_table->clear();
+    killers.clear();
+    for (auto& team_history : history) {
+        std::fill(team_history.begin(), team_history.end(), 0);
+    }
 }
 
 Node Searcher::search(const DomineeringState& state,
         const unsigned depth_limit) {
-    if (root.team != last_team) {
-        last_team = root.team;
+    if (state.getWho() != last_team) {
+        last_team = state.getWho();
         timer = Timer(240);
     }
 
     timer.click();
+    const double start = Timer::now();
+    const float budget = move_time > 0 ? move_time : timer.get_move_time();
 
-    if (move_thread.joinable()) {
+    Node best;
+    endgame_solved = false;
+    dfpn_solved = false;
+    const Bitboard board(state);
+    // The endgame solver settles the position, which is worth more than
+    // what pondering found. The search that follows it if it fails still
+    // finds the pondered nodes in the table.
+    ponder_hit = move_thread.joinable()
+        && state == ponder_state
+        && state.getWho() == ponder_state.getWho()
+        && !in_endgame(board);
+    if (ponder_hit) {
+        // The opponent made the expected reply. The search of this state is
+        // already under way, let it go on for as long as a new one would.
+        iteration_deadline = start + budget * NEXT_ITERATION_RATIO;
+        deadline = start + budget;
+        start_dfpn(board, start + budget);
         move_thread.join();
+        best = ponder_result;
+        stop_dfpn(board, best);
     }
-    // Initialize best moves
-    best_moves.resize(depth_limit + 1);
-    std::fill(best_moves.begin(), best_moves.end(), Node());
+    else {
+        stop_pondering();
 
-    AlphaBeta ab(AlphaBeta::NEG_INF, AlphaBeta::POS_INF);
-    // Remove all the useless information currently stored in the table
-    tp_table.clear();
-    search_under(root, ab, state, depth_limit);
+        root = Node(state.getWho(), 0);
+        iteration_deadline = start + budget * NEXT_ITERATION_RATIO;
+        deadline = start + budget;
+        if (!solve_endgame(board, start + budget * ENDGAME_TIME_RATIO,
+                           best)) {
+            // The solver may have used up its share of the time, the
+            // deepening gets its part of what is left
+            const double now = Timer::now();
+            iteration_deadline =
+                now + (start + budget - now) * NEXT_ITERATION_RATIO;
+            start_dfpn(board, start + budget);
+            best = iterate(board, depth_limit);
+            stop_dfpn(board, best);
+        }
+    }
 
     timer.click();
 
+    return best;
+}
+
+void Searcher::ponder(const DomineeringState& state,
+                      const Node& best,
+                      const unsigned depth_limit) {
+    stop_pondering();
+    if (!pondering || expected_reply == Location()) {
+        return;
+    }
+
+    ponder_state = state;
+    if (!ponder_state.makeMove(best.parent_move.to_move())
+            || !ponder_state.makeMove(expected_reply.to_move())) {
+        return;
+    }
+
+    // Two of the moves that were left have been made
+    const unsigned ponder_depth = depth_limit > 2 ? depth_limit - 2 : 1;
+
+    root = Node(ponder_state.getWho(), 0);
+    iteration_deadline = std::numeric_limits<double>::infinity();
+    deadline = std::numeric_limits<double>::infinity();
+    move_thread = std::thread([this, ponder_depth]() {
+        ponder_result = iterate(Bitboard(ponder_state), ponder_depth);
+    });
+}
+
+void Searcher::stop_pondering() {
+    if (move_thread.joinable()) {
+        iteration_deadline = 0;
+        deadline = 0;
+        move_thread.join();
+    }
+}
+
+Node Searcher::iterate(const Bitboard& state,
+                       const unsigned depth_limit) {
+    stopped = false;
+    nodes_until_check = CHECK_INTERVAL;
+    completed_depth = 0;
+    nodes_searched = 0;
+    researches = 0;
+    previous_best = Node();
+    expected_reply = Location();
+    nodes_per_depth.clear();
+    for (auto& helper : helpers) {
+        helper->nodes_searched = 0;
+        helper->nodes_per_depth.clear();
+    }
+
+    // Killers are only good for the positions they were found in
+    killers.clear();
+    for (auto& team_history : history) {
+        for (auto& h : team_history) {
+            h /= 2;
+        }
+    }
+
+    // Entries of earlier searches are kept, their bounds still hold for the
+    // depths they were searched to, but they make way for the new ones
+    tp_table->age();
+
+    Node best;
+    for (unsigned depth = 1; depth <= depth_limit; depth++) {
+        // Initialize best moves
+        best_moves.resize(depth + 1);
+        std::fill(best_moves.begin(), best_moves.end(), Node());
+        prepare_ordering(state, depth);
+        reply = Location();
+        start_helpers(state, depth);
+
+        Node result;
+        if (mode == Mode::MTDF) {
+            // Start from the score of the previous iteration
+            result = mtdf(state, depth, completed_depth > 0
+                          ? previous_best.score()
+                          : evaluate(state));
+        }
+        else if (completed_depth > 0 && aspiration_window > 0) {
+            result = aspiration_search(state, depth, previous_best.score());
+        }
+        else {
+            AlphaBeta ab(AlphaBeta::NEG_INF, AlphaBeta::POS_INF);
+            search_under(root, ab, state, depth);
+            result = best_moves.front();
+        }
+
+        // The result of the main thread is the one that counts
+        stop_helpers();
+
+        // Discard the iteration that ran out of time
+        if (stopped) {
+            break;
+        }
+
+        best = result;
+        previous_best = best;
+        expected_reply = reply;
+        completed_depth = depth;
+
+        // Win or loss is proven, searching deeper will not change anything
+        if (best.score() == AlphaBeta::POS_INF
+                || best.score() == AlphaBeta::NEG_INF) {
+            break;
+        }
+        if (Timer::now() > iteration_deadline) {
+            break;
+        }
+    }
+
+    for (auto& helper : helpers) {
+        nodes_searched += helper->nodes_searched;
+        const auto& helper_nodes = helper->nodes_per_depth;
+        if (nodes_per_depth.size() < helper_nodes.size()) {
+            nodes_per_depth.resize(helper_nodes.size());
+        }
+        for (size_t d = 0; d < helper_nodes.size(); d++) {
+            nodes_per_depth[d] += helper_nodes[d];
+        }
+    }
+
+    return best;
+}
+
+Node Searcher::aspiration_search(const Bitboard& state,
+                                 const unsigned depth_limit,
+                                 const score_t guess) {
+    score_t delta = aspiration_window;
+    AlphaBeta ab(shift(guess, -delta), shift(guess, delta));
+
+    while (true) {
+        search_under(root, ab, state, depth_limit);
+        if (stopped) {
+            break;
+        }
+
+        // Open the side of the window the score fell out of, further than
+        // the last time
+        const score_t score = best_moves.front().score();
+        delta = aspiration_growth > 1
+            ? shift(0, static_cast<long long>(delta) * aspiration_growth)
+            : AlphaBeta::POS_INF;
+        if (score <= ab.alpha && ab.alpha != AlphaBeta::NEG_INF) {
+            ab.alpha = shift(score, -delta);
+        }
+        else if (score >= ab.beta && ab.beta != AlphaBeta::POS_INF) {
+            ab.beta = shift(score, delta);
+        }
+        else {
+            break;
+        }
+        researches++;
+    }
+
     return best_moves.front();
 }
 
+Node Searcher::mtdf(const Bitboard& state,
+                    const unsigned depth_limit,
+                    score_t guess) {
+    score_t lower = AlphaBeta::NEG_INF;
+    score_t upper = AlphaBeta::POS_INF;
+    Node best;
+
+    while (lower < upper) {
+        // Test whether the score is at least `beta' or not
+        score_t beta = guess == lower ? guess + 1 : guess;
+        search_under(root, AlphaBeta(beta - 1, beta), state, depth_limit);
+        if (stopped) {
+            break;
+        }
+
+        const Node& result = best_moves.front();
+        guess = result.score();
+        const bool failed_high = guess >= beta;
+        if (failed_high) {
+            lower = guess;
+        }
+        else {
+            upper = guess;
+        }
+
+        // Only a search that moves the bound toward the side to move tells
+        // which move is the best: failing high for HOME, failing low for
+        // AWAY. The other kind only bounds every move from one side.
+        if (failed_high == (state.who == Who::HOME)) {
+            best = result;
+        }
+
+        // Every move loses, so no search ever did
+        if (best.is_unset) {
+            best = result;
+        }
+    }
+
+    return best;
+}
+
 void Searcher::search_under(const Node& base,
                             AlphaBeta ab,
-                            const DomineeringState& current_state,
+                            const Bitboard& current_state,
                             const unsigned depth_limit) {
+    if (out_of_time()) {
+        return;
+    }
+    nodes_searched++;
+    if (nodes_per_depth.size() <= base.depth) {
+        nodes_per_depth.resize(base.depth + 1);
+    }
+    nodes_per_depth[base.depth]++;
+
     Node& current_best = best_moves[base.depth];
 
     // Base case
@@ -96,161 +416,694 @@ void Searcher::search_under(const Node& base,
         return;
     }
 
-    // Check for transpositions that were already explored
-    bool found;
+    // Check for transpositions that were already explored. The root is not
+    // checked since it has to come up with a move. Bounds from a shallower
+    // search, e.g. the previous iteration, are not good enough to cut, but
+    // its best move is still searched first.
+    bool found = false;
     TranspositionTable::Entry entry;
-    std::tie(entry, found) = tp_table.check(current_state);
-    if (found && ab.can_prune(entry, base.team)) {
-        // Set score to the best value possible in our sub tree so that we get
-        // chosen by the parent, but that won't happen because there already
-        // is a better value somewhere in another sub tree.
-        current_best.set_score(base.team == Who::HOME
+    if (base.depth > 0) {
+        std::tie(entry, found) = tp_table->check(current_state);
+    }
+    if (base.depth > 0 && found && entry.usable(depth_limit - base.depth)
+            && ab.can_prune(entry)) {
+        current_best = base;
+        // Set score to the bound that lies outside of the window so that the
+        // parent knows which way we failed. Both bounds are the same if the
+        // score is exact.
+        current_best.set_score(entry.lower_limit >= ab.beta
                                ? entry.lower_limit
                                : entry.upper_limit);
         current_best.lower_limit = entry.lower_limit;
         current_best.upper_limit = entry.upper_limit;
+        current_best.descentdants_searched = 1;
+        return;
+    }
+
+    // Positions solved in earlier games, and late in the game, positions
+    // whose regions tell who wins. The root only takes a win from a solved
+    // position, as it has to come up with a move.
+    Who winner;
+    Location solved_move;
+    const bool solved = depth_limit - base.depth >= SOLVED_MIN_DRAFT
+        && ((solutions->probe(current_state, winner, solved_move)
+             && (base.depth > 0 || (winner == base.team
+                                    && current_state.legal(base.team,
+                                                           solved_move))))
+            || (base.depth > 0 && region_analysis
+                && Bitboard::count(current_state.empty()) <= REGION_MAX_EMPTY
+                && regions.decide(current_state, winner)));
+    if (solved) {
+        const score_t score = winner == Who::HOME
+            ? AlphaBeta::POS_INF
+            : AlphaBeta::NEG_INF;
+        current_best = base.depth > 0
+            ? base
+            : Node(base.team == Who::HOME ? Who::AWAY : Who::HOME,
+                   base.depth + 1, solved_move);
+        current_best.set_score(score);
+        current_best.lower_limit = score;
+        current_best.upper_limit = score;
+        current_best.descentdants_searched = 1;
         return;
     }
 
+    // The window we were called with. Used to tell if the score is exact.
+    const AlphaBeta window{ab};
+    long unsigned descendants = 1;
+
+    // Nothing has been searched under this node yet
+    current_best.is_unset = true;
+
+    Bitboard next_state{current_state};
+    next_state.who = base.team == Who::HOME ? Who::AWAY : Who::HOME;
+
+    // Search the best move found the last time first. If it causes a cutoff
+    // again, the other moves do not even have to be generated. Boards are
+    // only told apart by their keys, so the move is checked in case another
+    // board had the same key.
+    Location hash_move;
+    bool cutoff = false;
+    if (base.depth > 0 && found
+            && current_state.legal(base.team, entry.best_move)) {
+        hash_move = entry.best_move;
+        Node child(base.team == Who::HOME ? Who::AWAY : Who::HOME,
+                   base.depth + 1, hash_move);
+        descendants += search_child(base, child, ab, next_state,
+                                    depth_limit, true);
+        if (stopped) {
+            return;
+        }
+
+        child.set_score(best_moves[base.depth + 1].score());
+        cutoff = update_best(base, child, current_best, ab);
+        if (cutoff) {
+            record_cutoff(base, child, current_state, depth_limit);
+        }
+    }
+
     std::vector<Node> children;
-    children = expand(base, current_state);
+    if (!cutoff) {
+        children = expand(base, current_state);
+    }
 
     // `base' is a terminal node
-    if (children.empty()) {
+    if (children.empty() && current_best.is_unset) {
         current_best = base;
-        current_best.set_as_terminal(current_state);
+        current_best.set_as_terminal();
+        current_best.lower_limit = current_best.score();
+        current_best.upper_limit = current_best.score();
         return;
     }
 
-    /*
-     * Reset the score to POS_INF or NEG_INF depending on which team this node
-     * belongs to.
-     */
-    current_best.set_score(base.team == Who::HOME
-                           ? AlphaBeta::NEG_INF
-                           : AlphaBeta::POS_INF);
-
-    DomineeringState next_state{current_state};
-    next_state.togglePlayer();
-
-    for (Node& child : children) {
-        // Update board to simulate placing the child.
-        // Done so that we don't need to make a copy of state for each child.
-        tap(child, next_state);
+    // The hash move has been searched already
+    if (hash_move != Location()) {
+        children.erase(std::remove_if(children.begin(), children.end(),
+                                      [&](const Node& child) {
+                                      return child.parent_move == hash_move;
+                                      }),
+                       children.end());
+    }
 
-        // Recursive call
-        search_under(child, ab, next_state, depth_limit);
+    if (move_ordering) {
+        order(base, current_state, children);
+    }
 
-        // Rewind to board before placing the child
-        untap(child, next_state);
+    // Search the best move of the previous iteration first
+    if (base.depth == 0 && !children.empty()) {
+        auto it = std::find_if(children.begin(), children.end(),
+                               [&](const Node& child) {
+                               return child.parent_move
+                                   == previous_best.parent_move;
+                               });
+        if (it != children.end()) {
+            std::rotate(children.begin(), it, it + 1);
+        }
 
-        const Node& next_move{best_moves[base.depth + 1]};
+        // Helper threads start from different moves than the main thread
+        std::rotate(children.begin(),
+                    children.begin() + root_offset % children.size(),
+                    children.end());
+    }
 
-        if (next_move.is_terminal()) {
-            child.set_as_terminal(next_state);
-        }
-        else {
-            child.set_score(next_move.score());
+    for (size_t i = 0; i < children.size(); i++) {
+        // The eldest brother is done, the younger ones can be searched by
+        // the idle threads
+        if (!current_best.is_unset && can_split(base, depth_limit)) {
+            split(base, ab, next_state, children, i, depth_limit,
+                  current_best, descendants);
+            if (stopped) {
+                return;
+            }
+            break;
         }
 
-        current_best.update_limits(next_move);
-        current_best.descentdants_searched += next_move.descentdants_searched;
+        Node& child = children[i];
+        descendants += search_child(base, child, ab, next_state,
+                                    depth_limit, current_best.is_unset);
 
-        bool result_better = base.team == Who::HOME
-            ? child.score() > current_best.score()
-            : child.score() < current_best.score();
-        if (result_better || current_best.is_unset) {
-            current_best = child;
+        // The result of the child is incomplete
+        if (stopped) {
+            return;
+        }
 
-            ab.update_if_needed(child.score(), base.team);
-            if (ab.can_prune(child.score(), base.team)) {
-                // Add result to transposition table
-                tp_table.insert(current_state,
-                                current_best.lower_limit,
-                                current_best.upper_limit,
-                                current_best.descentdants_searched);
-                return;
-            }
+        child.set_score(best_moves[base.depth + 1].score());
+        cutoff = update_best(base, child, current_best, ab);
+        if (base.depth == 0 && current_best.parent_move == child.parent_move) {
+            reply = searched_reply();
+        }
+        if (cutoff) {
+            record_cutoff(base, child, current_state, depth_limit);
+            break;
         }
     }
 
-    // Set true score since there was no pruning
-    current_best.lower_limit = current_best.score();
-    current_best.upper_limit = current_best.score();
+    current_best.descentdants_searched = descendants;
+
+    // The score is only a bound if it lies outside of the original window
+    const score_t score = current_best.score();
+    current_best.lower_limit = score > window.alpha
+        ? score
+        : AlphaBeta::NEG_INF;
+    current_best.upper_limit = score < window.beta
+        ? score
+        : AlphaBeta::POS_INF;
+
     // Add result to transposition table
-    tp_table.insert(current_state,
+    tp_table->insert(current_state,
                     current_best.lower_limit,
                     current_best.upper_limit,
-                    current_best.descentdants_searched);
+                    depth_limit - base.depth,
+                    current_best.parent_move);
 
     return;
 }
 
-Evaluator::score_t Searcher::evaluate(const DomineeringState& state) {
-    // A copy of the state so that we can mark places temporarily and pass
-    // that around to various evaluators
-    DomineeringState state_copy{state};
-    using score_t = Evaluator::score_t;
+long unsigned Searcher::search_child(const Node& base,
+                                     const Node& child,
+                                     const AlphaBeta& ab,
+                                     Bitboard& next_state,
+                                     const unsigned depth_limit,
+                                     const bool first) {
+    long unsigned descendants = 0;
+
+    // Update board to simulate placing the child.
+    // Done so that we don't need to make a copy of state for each child.
+    tap(child, next_state);
+
+    // Recursive call
+    if (mode == Mode::PVS && !first) {
+        // Only find out whether this child beats the best one so far
+        search_under(child, ab.null_window(base.team),
+                     next_state, depth_limit);
 
-    score_t home_score = RESERVED_FACTOR * home_reserved(&state_copy)
-        + OPEN_FACTOR * home_open(&state_copy);
+        const Node& probe{best_moves[base.depth + 1]};
+        if (!stopped && ab.inside(probe.score())) {
+            descendants += probe.descentdants_searched;
+            search_under(child, ab, next_state, depth_limit);
+        }
+    }
+    else {
+        search_under(child, ab, next_state, depth_limit);
+    }
+
+    // Rewind to board before placing the child
+    untap(child, next_state);
+
+    return descendants + best_moves[base.depth + 1].descentdants_searched;
+}
+
+bool Searcher::update_best(const Node& base,
+                           const Node& child,
+                           Node& current_best,
+                           AlphaBeta& ab) {
+    bool result_better = base.team == Who::HOME
+        ? child.score() > current_best.score()
+        : child.score() < current_best.score();
+    if (result_better || current_best.is_unset) {
+        current_best = child;
+
+        ab.update_if_needed(child.score(), base.team);
+        return ab.can_prune(child.score(), base.team);
+    }
+    return false;
+}
 
-    clear_marks(&state_copy);
+Evaluator::score_t Searcher::evaluate(const Bitboard& board) {
+    const Evaluator::Counts home = home_places(board);
+    const Evaluator::Counts away = away_places(board);
 
-    score_t away_score = RESERVED_FACTOR * away_reserved(&state_copy)
-        + OPEN_FACTOR * away_open(&state_copy);
+    return RESERVED_FACTOR * (home.reserved - away.reserved)
+        + OPEN_FACTOR * (home.open - away.open);
+}
 
-    return home_score - away_score;
+void Searcher::collect_solutions() {
+    tp_table->for_each_proven([this](const std::uint64_t key,
+                                     const Who winner,
+                                     const unsigned move) {
+                              solutions->add(key, winner, move);
+                              });
 }
 
 void Searcher::cleanup() {
-    if (move_thread.joinable()) {
-        move_thread.join();
+    stop_pondering();
+    stop_helpers();
+}
+
+void Searcher::set_threads(const unsigned threads) {
+    stop_helpers();
+    num_threads = std::max(threads, 1u);
+    if (helpers.size() >= num_threads) {
+        helpers.resize(num_threads - 1);
     }
 }
 
 /* Private methods */
 
+bool Searcher::in_endgame(const Bitboard& state) const {
+    const unsigned empty = Bitboard::count(state.empty());
+    const unsigned moves = Bitboard::count(state.moves(state.who));
+    return (empty <= endgame_max_empty && endgame_max_empty > 0)
+        || (moves <= endgame_max_moves && endgame_max_moves > 0);
+}
+
+bool Searcher::solve_endgame(const Bitboard& state,
+                             const double deadline,
+                             Node& best) {
+    if (!in_endgame(state)) {
+        return false;
+    }
+
+    Who winner;
+    Location move;
+    if (!endgame.solve(state, deadline, winner, move)
+            || winner != state.who) {
+        return false;
+    }
+
+    const score_t score = winner == Who::HOME
+        ? AlphaBeta::POS_INF
+        : AlphaBeta::NEG_INF;
+    best = Node(state.who == Who::HOME ? Who::AWAY : Who::HOME, 1, move);
+    best.set_score(score);
+    best.lower_limit = score;
+    best.upper_limit = score;
+
+    endgame_solved = true;
+    nodes_searched = endgame.get_nodes_searched();
+    nodes_per_depth.clear();
+    completed_depth = Bitboard::count(state.empty()) / 2;
+    researches = 0;
+    expected_reply = Location();
+    return true;
+}
+
+score_t Searcher::shift(const score_t score, const long long delta) {
+    long long shifted = static_cast<long long>(score) + delta;
+    shifted = std::max<long long>(shifted, AlphaBeta::NEG_INF);
+    shifted = std::min<long long>(shifted, AlphaBeta::POS_INF);
+    return static_cast<score_t>(shifted);
+}
+
+void Searcher::start_dfpn(const Bitboard& state, const double deadline) {
+    dfpn_proven = false;
+    if (dfpn_max_empty == 0
+            || Bitboard::count(state.empty()) > dfpn_max_empty) {
+        return;
+    }
+    if (!dfpn) {
+        dfpn.reset(new DfpnSolver());
+    }
+
+    dfpn_halt = false;
+    dfpn_thread = std::thread([this, state, deadline]() {
+        dfpn_proven = dfpn->solve(state, deadline, dfpn_winner, dfpn_move,
+                                  &dfpn_halt);
+        if (dfpn_proven && dfpn_winner == state.who) {
+            // Nothing left to search for
+            iteration_deadline = 0;
+            this->deadline = 0;
+        }
+    });
+}
+
+void Searcher::stop_dfpn(const Bitboard& state, Node& best) {
+    if (!dfpn_thread.joinable()) {
+        return;
+    }
+    dfpn_halt = true;
+    dfpn_thread.join();
+
+    const score_t win = state.who == Who::HOME
+        ? AlphaBeta::POS_INF
+        : AlphaBeta::NEG_INF;
+    if (!dfpn_proven || dfpn_winner != state.who || best.score() == win) {
+        return;
+    }
+
+    best = Node(state.who == Who::HOME ? Who::AWAY : Who::HOME, 1,
+                dfpn_move);
+    best.set_score(win);
+    best.lower_limit = win;
+    best.upper_limit = win;
+    dfpn_solved = true;
+    expected_reply = Location();
+}
+
+void Searcher::start_helpers(const Bitboard& state,
+                             const unsigned depth_limit) {
+    while (helpers.size() + 1 < num_threads) {
+        helpers.emplace_back(new Searcher(tp_table, solutions,
+                                             region_database));
+        helpers.back()->root_offset = helpers.size();
+    }
+
+    if (parallelism == Parallelism::YBWC && !helpers.empty()) {
+        if (!pool) {
+            pool = std::make_shared<WorkerPool>();
+        }
+        pool->idle.clear();
+        pool->idle_count = 0;
+        pool->quit = false;
+        pool->halt = false;
+
+        for (auto& helper : helpers) {
+            // Inner nodes never use MTD(f)
+            helper->mode = mode == Mode::PVS ? Mode::PVS : Mode::ALPHA_BETA;
+            helper->move_ordering = move_ordering;
+            helper->region_analysis = region_analysis;
+            helper->pool = pool;
+            helper->assigned = nullptr;
+            helper->cancelled = false;
+
+            Searcher* h = helper.get();
+            helper_threads.emplace_back([h]() { h->work(); });
+        }
+        return;
+    }
+    pool = nullptr;
+
+    for (auto& helper : helpers) {
+        // Every other helper searches one ply deeper, so that the main
+        // thread finds entries in the table it can cut with before it gets
+        // to the next iteration
+        const unsigned depth = depth_limit + helper->root_offset % 2;
+
+        // Helpers always use the full window, MTD(f) is only for the root
+        helper->mode = mode == Mode::PVS ? Mode::PVS : Mode::ALPHA_BETA;
+        helper->move_ordering = move_ordering;
+        helper->region_analysis = region_analysis;
+        helper->prepare_ordering(state, depth);
+        helper->root = root;
+        helper->previous_best = previous_best;
+        helper->stopped = false;
+        helper->cancelled = false;
+        helper->pool = nullptr;
+        helper->best_moves.assign(depth + 1, Node());
+
+        Searcher* h = helper.get();
+        helper_threads.emplace_back([h, state, depth]() {
+            h->search_under(h->root, AlphaBeta(), state, depth);
+        });
+    }
+}
+
+void Searcher::stop_helpers() {
+    if (pool) {
+        {
+            std::lock_guard<std::mutex> lock(pool->mutex);
+            pool->quit = true;
+        }
+        pool->wake.notify_all();
+    }
+    for (auto& helper : helpers) {
+        helper->cancelled = true;
+    }
+    for (std::thread& t : helper_threads) {
+        t.join();
+    }
+    helper_threads.clear();
+}
+
+void Searcher::prepare_ordering(const Bitboard& state,
+                                const unsigned depth_limit) {
+    if (killers.size() < depth_limit + 1) {
+        killers.resize(depth_limit + 1);
+    }
+    for (auto& team_history : history) {
+        team_history.resize(state.rows * state.cols);
+    }
+}
+
+void Searcher::order(const Node& base,
+                     const Bitboard& state,
+                     std::vector<Node>& children) const {
+    const auto& slots = killers[base.depth];
+    const auto& team_history = history[static_cast<int>(base.team)];
+
+    auto priority = [&](const Node& child) {
+        for (unsigned i = 0; i < KILLER_SLOTS; i++) {
+            if (child.parent_move == slots[i]) {
+                return std::numeric_limits<long unsigned>::max() - i;
+            }
+        }
+        return team_history[state.index(child.parent_move)];
+    };
+
+    // Stable so that moves without any history keep the raster order
+    std::stable_sort(children.begin(), children.end(),
+                     [&](const Node& a, const Node& b) {
+                     return priority(a) > priority(b);
+                     });
+}
+
+void Searcher::record_cutoff(const Node& base,
+                             const Node& child,
+                             const Bitboard& state,
+                             const unsigned depth_limit) {
+    auto& slots = killers[base.depth];
+    if (slots[0] != child.parent_move) {
+        for (unsigned i = KILLER_SLOTS - 1; i > 0; i--) {
+            slots[i] = slots[i - 1];
+        }
+        slots[0] = child.parent_move;
+    }
+
+    // Cutoffs high up in the tree save more nodes
+    const long unsigned left = depth_limit - base.depth;
+    history[static_cast<int>(base.team)][state.index(child.parent_move)]
+        += left * left;
+}
+
+Location Searcher::searched_reply() const {
+    // A child that was a leaf, a terminal, or found in the transposition
+    // table leaves itself as its result
+    const Node& result = best_moves[1];
+    return result.depth == 2 ? result.parent_move : Location();
+}
+
+bool Searcher::can_split(const Node& base, const unsigned depth_limit) const {
+    return pool
+        && depth_limit - base.depth >= MIN_SPLIT_DEPTH
+        && pool->idle_count.load(std::memory_order_relaxed) > 0;
+}
+
+void Searcher::split(const Node& base,
+                     AlphaBeta& ab,
+                     Bitboard& next_state,
+                     std::vector<Node>& children,
+                     const size_t next_child,
+                     const unsigned depth_limit,
+                     Node& current_best,
+                     long unsigned& descendants) {
+    SplitPoint sp{next_state};
+    sp.parent = current_split;
+    sp.base = &base;
+    sp.children = &children;
+    sp.next_child = next_child;
+    sp.depth_limit = depth_limit;
+    sp.ab = ab;
+    sp.best = current_best;
+    sp.reply = reply;
+
+    // Recruit every idle thread
+    {
+        std::lock_guard<std::mutex> lock(pool->mutex);
+        for (Searcher* worker : pool->idle) {
+            worker->assigned = &sp;
+        }
+        sp.workers = pool->idle.size();
+        pool->idle.clear();
+        pool->idle_count = 0;
+    }
+    pool->wake.notify_all();
+
+    search_split(sp, next_state);
+
+    // Wait for the others to finish their children
+    {
+        std::unique_lock<std::mutex> lock(sp.mutex);
+        sp.done.wait(lock, [&sp]() { return sp.workers == 0; });
+    }
+
+    current_best = sp.best;
+    if (base.depth == 0) {
+        reply = sp.reply;
+    }
+    ab = sp.ab;
+    descendants += sp.descendants;
+}
+
+void Searcher::search_split(SplitPoint& sp, Bitboard& next_state) {
+    SplitPoint* outer = current_split;
+    current_split = &sp;
+
+    while (true) {
+        Node child;
+        AlphaBeta ab;
+        {
+            std::lock_guard<std::mutex> lock(sp.mutex);
+            if (sp.cutoff || sp.next_child >= sp.children->size()) {
+                break;
+            }
+            child = (*sp.children)[sp.next_child++];
+            ab = sp.ab;
+        }
+
+        long unsigned descendants = search_child(*sp.base, child, ab,
+                                                 next_state, sp.depth_limit,
+                                                 false);
+        if (stopped) {
+            // A cutoff at this split point only abandons this child
+            stopped = aborted(sp.parent);
+            if (stopped) {
+                break;
+            }
+            continue;
+        }
+
+        child.set_score(best_moves[sp.base->depth + 1].score());
+
+        std::lock_guard<std::mutex> lock(sp.mutex);
+        sp.descendants += descendants;
+        if (update_best(*sp.base, child, sp.best, sp.ab)) {
+            sp.cutoff = true;
+            record_cutoff(*sp.base, child, next_state, sp.depth_limit);
+        }
+        if (sp.base->depth == 0 && sp.best.parent_move == child.parent_move) {
+            sp.reply = searched_reply();
+        }
+    }
+
+    current_split = outer;
+}
+
+void Searcher::work() {
+    std::unique_lock<std::mutex> lock(pool->mutex);
+
+    while (true) {
+        pool->idle.push_back(this);
+        pool->idle_count++;
+        pool->wake.wait(lock, [this]() {
+                        return assigned != nullptr || pool->quit;
+                        });
+        if (assigned == nullptr) {
+            return;
+        }
+        SplitPoint& sp = *assigned;
+        lock.unlock();
+
+        if (best_moves.size() < sp.depth_limit + 1) {
+            best_moves.resize(sp.depth_limit + 1);
+        }
+        prepare_ordering(sp.state, sp.depth_limit);
+        stopped = false;
+        Bitboard next_state{sp.state};
+        search_split(sp, next_state);
+
+        // The owner may destroy the split point as soon as we leave it
+        {
+            std::lock_guard<std::mutex> sp_lock(sp.mutex);
+            if (--sp.workers == 0) {
+                sp.done.notify_all();
+            }
+        }
+
+        lock.lock();
+        assigned = nullptr;
+    }
+}
+
+bool Searcher::aborted(const SplitPoint* sp) const {
+    if (pool && pool->halt.load(std::memory_order_relaxed)) {
+        return true;
+    }
+    for (; sp != nullptr; sp = sp->parent) {
+        if (sp->cutoff.load(std::memory_order_relaxed)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Searcher::out_of_time() {
+    if (stopped) {
+        return true;
+    }
+    // Helper threads stop as soon as the main thread is done
+    if (cancelled.load(std::memory_order_relaxed)) {
+        stopped = true;
+        return true;
+    }
+    if (current_split != nullptr && aborted(current_split)) {
+        stopped = true;
+        return true;
+    }
+    if (--nodes_until_check > 0) {
+        return false;
+    }
+    nodes_until_check = CHECK_INTERVAL;
+
+    if (completed_depth > 0
+            && Timer::now() >= deadline.load(std::memory_order_relaxed)) {
+        stopped = true;
+        // Stop the YBWC helpers too
+        if (pool) {
+            pool->halt = true;
+        }
+    }
+    return stopped;
+}
+
 std::vector<Node> Searcher::expand(const Node& base,
-        const DomineeringState& current_state) {
+        const Bitboard& current_state) {
     // Toggle player
     Who child_team = base.team == Who::HOME ? Who::AWAY : Who::HOME;
     unsigned child_depth = base.depth + 1;
     std::vector<Node> children;
 
-    // Create one instance and modify the values so that we don't have to
-    // instantiate a ton of vectors in GameMove constructor.
-    DomineeringMove parent_move{0, 0, 0, 0};
-    for (unsigned r1 = 0; r1 < current_state.ROWS; r1++) {
-        for (unsigned c1 = 0; c1 < current_state.COLS; c1++) {
-            // Home places horizontally, Away places vertically
-            unsigned r2 = base.team == Who::HOME ? r1 : r1 + 1;
-            unsigned c2 = base.team == Who::HOME ? c1 + 1 : c1;
-
-            parent_move.setMv(r1, c1, r2, c2);
-
-            if (current_state.moveOK(parent_move)) {
-                // Note: my_move is HOW I got to this state i.e. base's move
-                children.push_back(Node(child_team,
-                                        child_depth,
-                                        Location(parent_move)));
-            }
-        }
+    // Home places horizontally, Away places vertically
+    Bitboard::bits_t moves = current_state.moves(base.team);
+    children.reserve(Bitboard::count(moves));
+    for (; moves != 0; moves &= moves - 1) {
+        const unsigned i = Bitboard::lowest(moves);
+        // Note: my_move is HOW I got to this state i.e. base's move
+        children.push_back(Node(child_team,
+                                child_depth,
+                                current_state.location(base.team, i)));
     }
     return children;
 }
 
-void Searcher::tap(const Node& node, DomineeringState& state) {
-    // To reflect the base's team, flip the symbols
-    char c = node.team == Who::HOME ? state.AWAYSYM : state.HOMESYM;
-    state.setCell(node.parent_move.r1, node.parent_move.c1, c);
-    state.setCell(node.parent_move.r2, node.parent_move.c2, c);
+void Searcher::tap(const Node& node, Bitboard& state) {
+    // The domino belongs to the team of the base
+    const Who team = node.team == Who::HOME ? Who::AWAY : Who::HOME;
+    state.toggle(team, state.index(node.parent_move));
 }
 
-void Searcher::untap(const Node& node, DomineeringState& state) {
-    char c = state.EMPTYSYM;
-    state.setCell(node.parent_move.r1, node.parent_move.c1, c);
-    state.setCell(node.parent_move.r2, node.parent_move.c2, c);
+void Searcher::untap(const Node& node, Bitboard& state) {
+    // Placing the same domino again removes it
+    tap(node, state);
 }
 
 /* vim: tw=78:et:ts=4:sts=4:sw=4 */
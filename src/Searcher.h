@@ -2,15 +2,26 @@
 #define SEARCHER_H_
 
 #include "AlphaBeta.h"
+#include "Bitboard.h"
+#include "DfpnSolver.h"
 #include "DomineeringState.h"
+#include "EndgameSolver.h"
 #include "Evaluators.h"
 #include "Location.h"
 #include "Node.h"
+#include "Regions.h"
+#include "SolutionCache.h"
 #include "TranspositionTable.h"
 #include "Timer.h"
 
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
 #include <fstream>
+#include <limits>
+#include <memory>
+#include <mutex>
 #include <unordered_map>
 #include <vector>
 #include <unordered_map>
@@ -23,16 +34,39 @@
 
 class Searcher {
 public:
-    // Default constructor
-    Searcher();
+    /**
+     * The algorithm used to search the children of a node.
+     *
+     * ALPHA_BETA: every child is searched with the full window.
+     * PVS: the first child is searched with the full window and the rest
+     *      with a null window, which are searched again only when they turn
+     *      out to be better (Principal Variation Search).
+     * MTDF: the root is searched repeatedly with null windows that close in
+     *       on the score, relying on the transposition table to not search
+     *       the same nodes again (MTD(f)).
+     */
+    enum class Mode {
+        ALPHA_BETA,
+        PVS,
+        MTDF
+    };
 
     /**
-     * Instantiates a searcher and read the transposition table from the given
-     * ifstream.
+     * How the threads other than the main thread help the search.
      *
-     * \param[in] ifs the ifstream to read the transposition table from.
+     * LAZY_SMP: every thread searches the whole tree on its own and they
+     *           only share the transposition table.
+     * YBWC: once the first child of a node has been searched, the rest of
+     *       the children are handed to idle threads (Young Brothers Wait
+     *       Concept). Searches roughly the same nodes as a single thread.
      */
-    Searcher(std::ifstream& ifs);
+    enum class Parallelism {
+        LAZY_SMP,
+        YBWC
+    };
+
+    // Default constructor
+    Searcher();
 
     // Copy constructor
     Searcher(const Searcher& other);
@@ -49,27 +83,85 @@ public:
     Searcher& operator=(Searcher&& other);
 
     /**
-     * Gives a starting point to this searcher.
+     * Forgets everything learned in the previous game: stops pondering and
+     * clears the transposition table and the move ordering heuristics. The
+     * table is otherwise kept from move to move.
+     */
+    void reset();
+
+    /**
+     * Searches for moves by iterative deepening.
+     * Each iteration searches one ply deeper than the previous one and tries
+     * the previous iteration's best move first. Deepening stops when the
+     * time budget for this move runs out, the given depth is reached, or the
+     * outcome of the game is proven.
+     * If the state is the one being pondered on, the search that is already
+     * under way is given the time budget instead of starting over, unless
+     * the state is late enough for the endgame solver.
+     *
+     * \param[in] state current state of the game configuration.
+     *
+     * \param[in] depth_limit the maximum depth to search.
      *
-     * \param[in] root the root of the search tree.
+     * \return the node that represents the best move found by the last
+     *         completed iteration.
      */
-    void set_root(const Node& root);
+    Node search(const DomineeringState& state, const unsigned depth_limit);
 
     /**
-     * Does housekeeping stuff such as clearing the transposition table.
+     * Starts searching, on the opponent's time, the state we expect to be in
+     * on our next turn: our move followed by the reply that the last search
+     * expected from the opponent. Does nothing if pondering is disabled or
+     * no reply is known.
+     *
+     * \param[in] state the state our move was chosen in.
+     *
+     * \param[in] best our move, as returned by Searcher::search.
+     *
+     * \param[in] depth_limit the maximum depth to search from `state'.
      */
-    void reset();
+    void ponder(const DomineeringState& state,
+                const Node& best,
+                const unsigned depth_limit);
 
     /**
-     * Searches for moves until it reaches the given depth.
+     * Stops pondering, if it is going on, and waits for the thread.
+     */
+    void stop_pondering();
+
+    /**
+     * Searches the root with a narrow window around the score of the
+     * previous iteration. If the score falls outside of the window, that
+     * side of the window is widened and the root is searched again.
      *
-     * \param[in] state current state of the game configuration.
+     * \param[in] state current state of the game.
      *
-     * \param[in] depth_limit the maximum depth to search.
+     * \param[in] depth_limit the maximum depth to go down.
+     *
+     * \param[in] guess the score of the previous iteration.
      *
      * \return the node that represents the best move to make.
      */
-    Node search(const DomineeringState& state, const unsigned depth_limit);
+    Node aspiration_search(const Bitboard& state,
+                           const unsigned depth_limit,
+                           const score_t guess);
+
+    /**
+     * Finds the score of the root by a sequence of null window searches,
+     * each of which tells whether the score is above or below a guess.
+     *
+     * \param[in] state current state of the game.
+     *
+     * \param[in] depth_limit the maximum depth to go down.
+     *
+     * \param[in] guess first guess of the score. The closer it is to the
+     *                  actual score, the fewer searches are needed.
+     *
+     * \return the node that represents the best move to make.
+     */
+    Node mtdf(const Bitboard& state,
+              const unsigned depth_limit,
+              score_t guess);
 
     /**
      * Searches under the given node.
@@ -87,7 +179,7 @@ public:
      */
     void search_under(const Node& base,
                       AlphaBeta ab,
-                      const DomineeringState& state,
+                      const Bitboard& state,
                       const unsigned depth_limit);
 
     /**
@@ -95,11 +187,11 @@ public:
      * a score to it.
      * TODO: pass in node also?
      *
-     * \param[in] state the state to be evaluated.
+     * \param[in] board the board to be evaluated.
      *
      * \return the score.
      */
-    Evaluator::score_t evaluate(const DomineeringState& state);
+    Evaluator::score_t evaluate(const Bitboard& board);
 
     /**
      * Does cleanup before the program exits.
@@ -109,8 +201,451 @@ public:
 
     float get_time_left() const { return timer.get_time_left(); }
 
+    /**
+     * \return the depth of the last completed iteration.
+     */
+    unsigned get_completed_depth() const { return completed_depth; }
+
+    /**
+     * \return the number of nodes visited by the last call to search, by
+     *         all threads.
+     */
+    long unsigned get_nodes_searched() const { return nodes_searched; }
+
+    /**
+     * \return the number of nodes visited at each depth by the last call to
+     *         search, by all threads. Index 0 is the root.
+     */
+    const std::vector<long unsigned>& get_nodes_per_depth() const {
+        return nodes_per_depth;
+    }
+
+    /**
+     * \return the number of times the root was searched again because the
+     *         score fell outside of the aspiration window.
+     */
+    long unsigned get_researches() const { return researches; }
+
+    /**
+     * \return true if the last call to search carried on with the search
+     *         started while pondering.
+     */
+    bool get_ponder_hit() const { return ponder_hit; }
+
+    /**
+     * \return true if the last call to search solved the position with the
+     *         endgame solver, and found a winning move.
+     */
+    bool get_endgame_solved() const { return endgame_solved; }
+
+    /**
+     * \return true if the move of the last call to search was proven to
+     *         win by the df-pn solver thread.
+     */
+    bool get_dfpn_solved() const { return dfpn_solved; }
+
+    void set_pondering(const bool enabled) { pondering = enabled; }
+
+    /**
+     * Turns the killer move and history heuristics on or off. When off, the
+     * children are searched in the order Searcher::expand generates them.
+     */
+    void set_move_ordering(const bool enabled) { move_ordering = enabled; }
+
+    /**
+     * Turns the analysis of the regions of the board on or off. When on,
+     * nodes with few empty grids left are split into the regions of empty
+     * grids that do not touch, and the search stops where they tell which
+     * team wins. See Regions.
+     */
+    void set_region_analysis(const bool enabled) {
+        region_analysis = enabled;
+    }
+
+    /**
+     * Sets when the endgame solver takes over from the search: once there
+     * are at most that many empty grids, or the side to move has at most
+     * that many moves. The solver is given part of the time budget, and
+     * the search the rest if it does not finish or finds a loss, in which
+     * case the search picks the move that holds out longest. 0 turns either
+     * condition off, both are until this is called. See EndgameSolver.
+     */
+    void set_endgame(const unsigned max_empty, const unsigned max_moves) {
+        endgame_max_empty = max_empty;
+        endgame_max_moves = max_moves;
+        if (max_empty > 0 || max_moves > 0) {
+            endgame.allocate();
+        }
+    }
+
+    /**
+     * Runs a df-pn solver in a thread of its own next to the search once
+     * at most that many grids are empty, 0 for never. If it proves a win
+     * before the time is up, the search stops and its move is played. See
+     * DfpnSolver.
+     */
+    void set_dfpn(const unsigned max_empty) { dfpn_max_empty = max_empty; }
+
+    void set_mode(const Mode mode) { this->mode = mode; }
+
+    /**
+     * Sets up the aspiration windows used from the second iteration on.
+     *
+     * \param[in] window how far the window extends on each side of the
+     *                   previous score. 0 searches with the full window.
+     *
+     * \param[in] growth how many times wider the window gets every time
+     *                   the score falls outside of it. 1 or less opens that
+     *                   side of the window completely.
+     */
+    void set_aspiration(const score_t window, const unsigned growth);
+
+    /**
+     * Sets the number of threads to search with (Lazy SMP). The threads
+     * other than the main thread search the same root at the same time,
+     * starting from different moves and every other one a ply deeper, and
+     * share the transposition table so that the main thread finds more of
+     * its nodes already searched. Only the result of the main thread is
+     * used.
+     *
+     * \param[in] threads the number of threads, including the main thread.
+     */
+    void set_threads(const unsigned threads);
+
+    void set_parallelism(const Parallelism parallelism) {
+        this->parallelism = parallelism;
+    }
+
+    /**
+     * Sets a fixed number of seconds to spend on each move.
+     *
+     * \param[in] seconds the time per move. 0 divides the time left in the
+     *                    game among the moves that are left.
+     */
+    void set_move_time(const float seconds) { move_time = seconds; }
+
+    /**
+     * Changes the size of the transposition table, which is shared with the
+     * helper threads. Clears it.
+     *
+     * \param[in] megabytes the memory to use.
+     */
+    void set_table_size(const size_t megabytes) {
+        tp_table->resize(megabytes);
+    }
+
+    /**
+     * \return the positions solved in earlier games, which are looked up
+     *         before searching. Shared with the helper threads and the
+     *         copies of the searcher.
+     */
+    SolutionCache& get_solutions() { return *solutions; }
+
+    /**
+     * Adds the positions the transposition table proves a win for to the
+     * solved positions. To be called when not searching, before the table
+     * is cleared.
+     */
+    void collect_solutions();
+
+    /**
+     * \return the values of regions computed ahead of time, which the
+     *         region analysis adds up. To be opened before searching.
+     *         Shared with the helper threads and the copies of the
+     *         searcher.
+     */
+    RegionDatabase& get_region_database() { return *region_database; }
+
 private:
+    /**
+     * \return true if the position is late enough in the game for the
+     *         endgame solver. See Searcher::set_endgame.
+     */
+    bool in_endgame(const Bitboard& state) const;
+
+    /**
+     * Solves the position with the endgame solver if it is late enough in
+     * the game.
+     *
+     * \param[in] state the position.
+     *
+     * \param[in] deadline when to give up.
+     *
+     * \param[out] best the child with the winning move.
+     *
+     * \return true if a winning move was found.
+     */
+    bool solve_endgame(const Bitboard& state,
+                       const double deadline,
+                       Node& best);
+
+    /**
+     * Starts the df-pn thread on the position if it is late enough in the
+     * game. A proven win stops the search.
+     */
+    void start_dfpn(const Bitboard& state, const double deadline);
+
+    /**
+     * Stops and joins the df-pn thread, and replaces the result of the
+     * search by its move if it proved a win the search did not.
+     */
+    void stop_dfpn(const Bitboard& state, Node& best);
+
+    /**
+     * Instantiates a helper that searches with the given transposition
+     * table, solved positions and region values instead of its own.
+     */
+    Searcher(const std::shared_ptr<TranspositionTable>& table,
+             const std::shared_ptr<SolutionCache>& solutions,
+             const std::shared_ptr<RegionDatabase>& region_database);
+
+    /**
+     * A node whose remaining children are searched by several threads.
+     * Each thread takes the next child that nobody has taken yet, searches
+     * it with its own stack, and merges the result under the lock.
+     */
+    struct SplitPoint {
+        SplitPoint(const Bitboard& state)
+            : state{state}
+        { }
+
+        /* The split point the owner was working under, if any */
+        SplitPoint* parent = nullptr;
+        const Node* base = nullptr;
+        /* State of the node with the turn given to the children */
+        Bitboard state;
+        std::vector<Node>* children = nullptr;
+        /* Index of the next child nobody has taken yet */
+        size_t next_child = 0;
+        unsigned depth_limit = 0;
+
+        AlphaBeta ab;
+        Node best;
+        /* The reply to `best' if the node is the root */
+        Location reply;
+        long unsigned descendants = 0;
+
+        /* Number of threads other than the owner working on this */
+        unsigned workers = 0;
+        /* Set when a child causes a cutoff */
+        std::atomic<bool> cutoff{false};
+
+        std::mutex mutex;
+        /* Signaled when the last worker leaves */
+        std::condition_variable done;
+    };
+
+    /**
+     * Threads that wait to be recruited to split points (YBWC).
+     */
+    struct WorkerPool {
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::vector<Searcher*> idle;
+        /* Number of idle threads. Can be read without the lock */
+        std::atomic<unsigned> idle_count{0};
+        bool quit = false;
+        /* Set when the main thread runs out of time */
+        std::atomic<bool> halt{false};
+    };
+
+    /**
+     * Number of killer moves remembered for each depth.
+     */
+    static const unsigned KILLER_SLOTS = 2;
+
+    /**
+     * Nodes with fewer plies below them than this are never split since
+     * handing them over costs more than searching them.
+     */
+    static const unsigned MIN_SPLIT_DEPTH = 3;
+
+    /**
+     * Number of nodes to visit between checks of the clock.
+     */
+    static const unsigned CHECK_INTERVAL = 4096;
+
+    /**
+     * An iteration is not started if more than this fraction of the time
+     * budget has been used, since it would most likely not finish. After
+     * the endgame solver, the fraction is of the time it left.
+     */
+    static constexpr float NEXT_ITERATION_RATIO = 0.5;
+
+    /**
+     * Fraction of the time budget the endgame solver may use before the
+     * search takes over.
+     */
+    static constexpr float ENDGAME_TIME_RATIO = 0.5;
+
     Timer timer;
+
+    Mode mode = Mode::ALPHA_BETA;
+
+    /**
+     * Number of nodes visited in the current search, including the nodes of
+     * iterations that ran out of time.
+     */
+    long unsigned nodes_searched = 0;
+
+    /**
+     * See Searcher::get_nodes_per_depth.
+     */
+    std::vector<long unsigned> nodes_per_depth;
+
+    bool move_ordering = true;
+
+    bool region_analysis = true;
+
+    /**
+     * See Searcher::set_endgame. The solver keeps its table from one search
+     * to the next, what it solved stays true.
+     */
+    EndgameSolver endgame;
+    unsigned endgame_max_empty = 0;
+    unsigned endgame_max_moves = 0;
+
+    /**
+     * See Searcher::get_endgame_solved.
+     */
+    bool endgame_solved = false;
+
+    /**
+     * See Searcher::set_dfpn. Made on first use, and kept from one search
+     * to the next.
+     */
+    std::unique_ptr<DfpnSolver> dfpn;
+    unsigned dfpn_max_empty = 0;
+    std::thread dfpn_thread;
+    std::atomic<bool> dfpn_halt{false};
+
+    /**
+     * What the df-pn thread proved, read once it is joined.
+     */
+    bool dfpn_proven = false;
+    Who dfpn_winner = Who::HOME;
+    Location dfpn_move;
+
+    /**
+     * See Searcher::get_dfpn_solved.
+     */
+    bool dfpn_solved = false;
+
+    /**
+     * Moves that caused a cutoff at each depth, most recent first. Positions
+     * at the same depth tend to be refuted by the same move, so these are
+     * searched before the other children (killer heuristic).
+     */
+    std::vector<std::array<Location, KILLER_SLOTS>> killers;
+
+    /**
+     * How often the moves of each team caused a cutoff, weighted by the
+     * depth that was left below the node. Indexed by team and by the grid the
+     * domino starts at (history heuristic). Halved at every search so that
+     * old positions fade out.
+     */
+    std::array<std::vector<long unsigned>, 2> history;
+
+    /**
+     * Half the width of the first aspiration window, and how much it grows
+     * on every failure. See Searcher::set_aspiration.
+     */
+    score_t aspiration_window = 0;
+    unsigned aspiration_growth = 0;
+
+    /**
+     * Number of times the root was searched again in the current search.
+     */
+    long unsigned researches = 0;
+
+    /**
+     * Number of threads to search with, including the main thread.
+     */
+    unsigned num_threads = 1;
+
+    /**
+     * Fixed number of seconds per move. See Searcher::set_move_time.
+     */
+    float move_time = 0;
+
+    Parallelism parallelism = Parallelism::LAZY_SMP;
+
+    /**
+     * Searchers that are run by the helper threads. They share the
+     * transposition table with this searcher.
+     */
+    std::vector<std::unique_ptr<Searcher>> helpers;
+
+    /**
+     * Threads that run the helpers during one iteration.
+     */
+    std::vector<std::thread> helper_threads;
+
+    /**
+     * Set by the main thread to stop a helper.
+     */
+    std::atomic<bool> cancelled{false};
+
+    /**
+     * How many moves a helper skips at the root before it starts searching.
+     * 0 for the main thread.
+     */
+    unsigned root_offset = 0;
+
+    /**
+     * Idle YBWC threads. Shared by the main searcher and its helpers, null
+     * unless YBWC is used.
+     */
+    std::shared_ptr<WorkerPool> pool;
+
+    /**
+     * The split point this thread is searching a child of, if any.
+     */
+    SplitPoint* current_split = nullptr;
+
+    /**
+     * The split point a YBWC helper has been recruited to. Guarded by the
+     * lock of the pool.
+     */
+    SplitPoint* assigned = nullptr;
+
+    /**
+     * Time of day (see Timer::now) at which the search is stopped, and after
+     * which no iteration is started. Infinite while pondering, and moved by
+     * the thread that calls search once the opponent has moved.
+     */
+    std::atomic<double> deadline{0};
+    std::atomic<double> iteration_deadline{0};
+
+    /**
+     * True if the current iteration ran out of time. Results of that
+     * iteration are incomplete and must not be used.
+     */
+    bool stopped = false;
+
+    /**
+     * Countdown of nodes until the clock is checked again.
+     */
+    unsigned nodes_until_check = CHECK_INTERVAL;
+
+    /**
+     * Depth of the last iteration that finished within the time budget.
+     */
+    unsigned completed_depth = 0;
+
+    /**
+     * Best move of the last completed iteration. Searched first in the next
+     * iteration.
+     */
+    Node previous_best;
+
+    /**
+     * Reply of the opponent to the best move at the root, in the current
+     * iteration and in the last completed one. Location() if unknown.
+     */
+    Location reply;
+    Location expected_reply;
+
     /**
      * The root of the search tree.
      */
@@ -136,15 +671,53 @@ private:
     std::unordered_map<DomineeringState, std::vector<Node>> ordered_moves;
 
     /**
-     * Thread that is spawned to do move ordering during the opponents turn.
+     * Thread that searches the state expected on our next turn during the
+     * opponent's turn.
      */
     std::thread move_thread;
 
+    /**
+     * Whether to ponder at all.
+     */
+    bool pondering = false;
+
+    /**
+     * The state searched by move_thread, and the result of that search.
+     */
+    DomineeringState ponder_state;
+    Node ponder_result;
+
+    /**
+     * See Searcher::get_ponder_hit.
+     */
+    bool ponder_hit = false;
+
     /**
      * Transposition table that is used to find duplicates in board
-     * configurations.
+     * configurations. Shared with the helper threads.
      */
-    TranspositionTable tp_table;
+    std::shared_ptr<TranspositionTable> tp_table;
+
+    /**
+     * Positions solved in earlier games. Only looked up in nodes with at
+     * least SOLVED_MIN_DRAFT plies left to search, where a hit saves more
+     * than the lookup costs.
+     */
+    std::shared_ptr<SolutionCache> solutions;
+    static const unsigned SOLVED_MIN_DRAFT = 2;
+
+    /**
+     * Values of regions computed ahead of time, see Regions.
+     */
+    std::shared_ptr<RegionDatabase> region_database;
+
+    /**
+     * Regions solved so far, by shape. Each thread has its own. Only used
+     * in nodes with at most REGION_MAX_EMPTY empty grids, as the board
+     * rarely splits before then.
+     */
+    Regions regions;
+    static const unsigned REGION_MAX_EMPTY = 40;
 
     Who last_team = Who::HOME;
 
@@ -154,41 +727,231 @@ private:
      * \param[in] base the node to expand.
      *
      * \param[in] current_state the state of the current game. Children are
-     *                          expanded by placing the base's team's
-     *                          dominoes onto current_state and checking if
-     *                          that is a valid move or not.
+     *                          the dominoes of the base's team that fit
+     *                          onto current_state.
      *
      * \return a vector of the expanded nodes. Note that the team of the nodes
      *         is the opposite of the base.
      */
     std::vector<Node> expand(const Node& base,
-                             const DomineeringState& current_state);
+                             const Bitboard& current_state);
+
+    /**
+     * Searches deeper and deeper until the deadlines set by the caller pass,
+     * the depth limit is reached, or the outcome of the game is proven.
+     *
+     * \param[in] state current state of the game. Its root is `root'.
+     *
+     * \param[in] depth_limit the maximum depth to search.
+     *
+     * \return the best move of the last completed iteration.
+     */
+    Node iterate(const Bitboard& state, const unsigned depth_limit);
+
+    /**
+     * Makes room in the killer and history tables for a search of the given
+     * depth.
+     */
+    void prepare_ordering(const Bitboard& state,
+                          const unsigned depth_limit);
+
+    /**
+     * Sorts the children so that killer moves come first, in the order they
+     * were found, followed by the rest by their history.
+     *
+     * \param[in] base the parent of the children.
+     *
+     * \param[in] state the state of the parent.
+     *
+     * \param[out] children the children to sort.
+     */
+    void order(const Node& base,
+               const Bitboard& state,
+               std::vector<Node>& children) const;
+
+    /**
+     * Remembers the child as a killer move at the depth of the parent and
+     * adds to its history.
+     *
+     * \param[in] base the node that had a cutoff.
+     *
+     * \param[in] child the child that caused it.
+     *
+     * \param[in] state the state of the parent.
+     *
+     * \param[in] depth_limit the maximum depth of the search.
+     */
+    void record_cutoff(const Node& base,
+                       const Node& child,
+                       const Bitboard& state,
+                       const unsigned depth_limit);
+
+    /**
+     * Starts the helper threads on one iteration of the search.
+     *
+     * \param[in] state current state of the game.
+     *
+     * \param[in] depth_limit the depth of the iteration.
+     */
+    void start_helpers(const Bitboard& state,
+                       const unsigned depth_limit);
+
+    /**
+     * Stops the helper threads and waits for them to finish.
+     */
+    void stop_helpers();
+
+    /**
+     * Searches one child of the given node, with a null window first if in
+     * PVS mode and the child is not the first one. The result is left in
+     * best_moves[base.depth + 1].
+     *
+     * \param[in] base the parent of the child.
+     *
+     * \param[in] child the child to search.
+     *
+     * \param[in] ab the window of the parent.
+     *
+     * \param[out] next_state the state of the parent with the turn given to
+     *                        the child. Restored before returning.
+     *
+     * \param[in] depth_limit the maximum depth to go down.
+     *
+     * \param[in] first true if no other child has been searched yet.
+     *
+     * \return the number of nodes searched under the child.
+     */
+    long unsigned search_child(const Node& base,
+                               const Node& child,
+                               const AlphaBeta& ab,
+                               Bitboard& next_state,
+                               const unsigned depth_limit,
+                               const bool first);
+
+    /**
+     * Replaces the best child of the node if the given child is better.
+     *
+     * \param[in] base the parent of the child.
+     *
+     * \param[in] child the child that has been searched.
+     *
+     * \param[out] current_best the best child so far.
+     *
+     * \param[out] ab the window of the parent, updated with the score.
+     *
+     * \return true if the rest of the children can be pruned.
+     */
+    bool update_best(const Node& base,
+                     const Node& child,
+                     Node& current_best,
+                     AlphaBeta& ab);
+
+    /**
+     * \return the best reply found under the child of the root that was just
+     *         searched by this thread, or Location() if it was not expanded.
+     */
+    Location searched_reply() const;
+
+    /**
+     * \return true if the rest of the children of the node should be handed
+     *         to idle threads.
+     */
+    bool can_split(const Node& base, const unsigned depth_limit) const;
+
+    /**
+     * Makes the node a split point, recruits every idle thread to it, and
+     * searches its remaining children together with them. Returns once all
+     * of them are done.
+     *
+     * \param[in] base the node to split.
+     *
+     * \param[out] ab the window of the node, updated with the scores.
+     *
+     * \param[out] next_state the state of the node with the turn given to
+     *                        the children. Restored before returning.
+     *
+     * \param[in] children the children of the node.
+     *
+     * \param[in] next_child index of the first child nobody has searched.
+     *
+     * \param[in] depth_limit the maximum depth to go down.
+     *
+     * \param[out] current_best the best child so far.
+     *
+     * \param[out] descendants the number of nodes searched under the node.
+     */
+    void split(const Node& base,
+               AlphaBeta& ab,
+               Bitboard& next_state,
+               std::vector<Node>& children,
+               const size_t next_child,
+               const unsigned depth_limit,
+               Node& current_best,
+               long unsigned& descendants);
+
+    /**
+     * Takes children of the split point one at a time and searches them
+     * until there are none left or one of them causes a cutoff.
+     *
+     * \param[out] sp the split point.
+     *
+     * \param[out] next_state this thread's copy of the split point's state.
+     */
+    void search_split(SplitPoint& sp, Bitboard& next_state);
+
+    /**
+     * Main loop of a YBWC helper thread. Waits to be recruited to a split
+     * point until the pool is shut down.
+     */
+    void work();
+
+    /**
+     * \return true if the search under the split point is useless, because
+     *         it or one of its ancestors had a cutoff, or the main thread ran
+     *         out of time.
+     */
+    bool aborted(const SplitPoint* sp) const;
+
+    /**
+     * Checks the clock every CHECK_INTERVAL nodes and stops the search if
+     * the time budget for this move has run out. The first iteration is
+     * never stopped so that there always is a move to play.
+     *
+     * \return true if the search should be abandoned.
+     */
+    bool out_of_time();
+
+    /**
+     * Adds delta to the score without going past NEG_INF or POS_INF.
+     */
+    static score_t shift(const score_t score, const long long delta);
 
     /**
      * Simulates the placing of a domino (i.e. move).
-     * This is done by placing changing the grids on the board pointed by the
-     * node to whatever team the node belongs to. Searcher::untap should be
-     * called to undo this action.
+     * This is done by flipping the bits of the grids pointed by the node in
+     * the bitboard of the team that made the move, and in the key of the
+     * board. Searcher::untap should be called to undo this action.
      *
      * \param[in] node the node that modified the state.
      *
      * \param[out] state the state to be undone.
      */
-    void tap(const Node& node, DomineeringState& state);
+    void tap(const Node& node, Bitboard& state);
 
     /**
-     * Rewinds the state to before tapping by clearing the place in the board
-     * where the domino was placed.
+     * Rewinds the state to before tapping by flipping the same bits back.
      *
      * \param[in] node the node that modified the state.
      *
      * \param[out] state the state to be undone.
      */
-    void untap(const Node& node, DomineeringState& state);
+    void untap(const Node& node, Bitboard& state);
 };
 
-inline void Searcher::set_root(const Node& root) {
-    this->root = root;
+inline void Searcher::set_aspiration(const score_t window,
+                                     const unsigned growth) {
+    aspiration_window = window;
+    aspiration_growth = growth;
 }
 
 #endif /* end of include guard */
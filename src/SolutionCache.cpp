@@ -0,0 +1,192 @@
+#include "SolutionCache.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+const char SolutionCache::MAGIC[8] = {'U', 'C', 'C', 'S', 'O', 'L', 'V', '1'};
+
+SolutionCache::SolutionCache() {
+    // Boards of the size in config/domineering.txt
+    Bitboard board;
+    rows = board.rows;
+    cols = board.cols;
+}
+
+SolutionCache::~SolutionCache() {
+    close();
+}
+
+bool SolutionCache::open(const std::string& path) {
+    close();
+    this->path = path;
+
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0
+            || static_cast<size_t>(st.st_size) < sizeof(Header)) {
+        ::close(fd);
+        return false;
+    }
+
+    // The mapping stays valid after the file is closed
+    mapping_size = st.st_size;
+    mapping = mmap(nullptr, mapping_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        mapping = nullptr;
+        mapping_size = 0;
+        return false;
+    }
+
+    const Header* header = static_cast<const Header*>(mapping);
+    const size_t expected = sizeof(Header) + header->count
+        * (sizeof(std::uint64_t) + sizeof(std::uint8_t));
+    if (std::memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0
+            || header->rows != rows || header->cols != cols
+            || mapping_size != expected) {
+        close();
+        return false;
+    }
+
+    count = header->count;
+    keys = reinterpret_cast<const std::uint64_t*>(header + 1);
+    outcomes = reinterpret_cast<const std::uint8_t*>(keys + count);
+    return true;
+}
+
+bool SolutionCache::save() {
+    if (path.empty()) {
+        return false;
+    }
+
+    // Both are free of duplicates, and a position solved twice has the
+    // same winner, so the first of each key is kept
+    std::vector<std::pair<std::uint64_t, std::uint8_t>> positions;
+    positions.reserve(size());
+    for (size_t i = 0; i < count; i++) {
+        positions.emplace_back(keys[i], outcomes[i]);
+    }
+    for (const auto& position : added) {
+        positions.push_back(position);
+    }
+    std::stable_sort(positions.begin(), positions.end(),
+                     [](const std::pair<std::uint64_t, std::uint8_t>& a,
+                        const std::pair<std::uint64_t, std::uint8_t>& b) {
+                     return a.first < b.first;
+                     });
+    positions.erase(std::unique(positions.begin(), positions.end(),
+                                [](const std::pair<std::uint64_t,
+                                                   std::uint8_t>& a,
+                                   const std::pair<std::uint64_t,
+                                                   std::uint8_t>& b) {
+                                return a.first == b.first;
+                                }),
+                    positions.end());
+
+    Header header;
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.rows = rows;
+    header.cols = cols;
+    header.count = positions.size();
+
+    // Written next to the file and moved over it, so that another player
+    // that has it mapped keeps reading the old one
+    const std::string temp_path = path + ".tmp";
+    {
+        std::ofstream ofs(temp_path, std::ios::binary | std::ios::trunc);
+        ofs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        for (const auto& position : positions) {
+            ofs.write(reinterpret_cast<const char*>(&position.first),
+                      sizeof(position.first));
+        }
+        for (const auto& position : positions) {
+            ofs.write(reinterpret_cast<const char*>(&position.second),
+                      sizeof(position.second));
+        }
+        if (!ofs) {
+            std::remove(temp_path.c_str());
+            return false;
+        }
+    }
+    if (std::rename(temp_path.c_str(), path.c_str()) != 0) {
+        std::remove(temp_path.c_str());
+        return false;
+    }
+
+    added.clear();
+    const std::string saved{path};
+    return open(saved);
+}
+
+bool SolutionCache::probe(const Bitboard& state,
+                          Who& winner,
+                          Location& move) const {
+    if (state.rows != rows || state.cols != cols) {
+        return false;
+    }
+
+    std::uint64_t key;
+    const unsigned symmetry = state.canonical(key);
+    std::uint8_t outcome;
+    if (!find(key, outcome)) {
+        return false;
+    }
+
+    // Swapping rows and columns swaps the teams
+    const bool away = (outcome & AWAY_WINS) != 0;
+    winner = away != Bitboard::swaps_teams(symmetry) ? Who::AWAY : Who::HOME;
+
+    const unsigned grid = outcome & NO_MOVE;
+    move = grid == NO_MOVE ? Location() : state.restore_move(symmetry, grid);
+    return true;
+}
+
+void SolutionCache::add(const std::uint64_t key,
+                        const Who winner,
+                        const unsigned move) {
+    const std::uint8_t grid = move < rows * cols ? move : NO_MOVE;
+    added[key] = grid | (winner == Who::AWAY ? AWAY_WINS : 0);
+}
+
+/* Private methods */
+
+void SolutionCache::close() {
+    if (mapping) {
+        munmap(mapping, mapping_size);
+    }
+    mapping = nullptr;
+    mapping_size = 0;
+    keys = nullptr;
+    outcomes = nullptr;
+    count = 0;
+}
+
+bool SolutionCache::find(const std::uint64_t key,
+                         std::uint8_t& outcome) const {
+    const std::uint64_t* it = std::lower_bound(keys, keys + count, key);
+    if (it != keys + count && *it == key) {
+        outcome = outcomes[it - keys];
+        return true;
+    }
+
+    const auto found = added.find(key);
+    if (found != added.end()) {
+        outcome = found->second;
+        return true;
+    }
+    return false;
+}
+
+/* vim: tw=78:et:ts=4:sts=4:sw=4 */
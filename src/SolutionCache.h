@@ -0,0 +1,135 @@
+#ifndef SOLUTION_CACHE_H_
+#define SOLUTION_CACHE_H_
+
+#include "Bitboard.h"
+#include "Location.h"
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+/**
+ * Positions whose winner is proven, kept on disk from one run to the next so
+ * that they never have to be searched again.
+ *
+ * The file holds a header, the keys of the positions in ascending order, and
+ * one byte per position with the winner and the move it found, all as seen
+ * through the symmetry that gave the key (see Bitboard::canonical). It is
+ * mapped into memory read-only, so opening it costs nothing however large
+ * it is, and searched by bisection. Positions solved since it was opened
+ * are kept in memory until SolutionCache::save merges them into the file.
+ */
+class SolutionCache {
+public:
+    SolutionCache();
+
+    SolutionCache(const SolutionCache& other) = delete;
+
+    ~SolutionCache();
+
+    SolutionCache& operator=(const SolutionCache& other) = delete;
+
+    /**
+     * Maps the file into memory. The file does not have to exist yet, it is
+     * created by SolutionCache::save. A file for another board size is
+     * ignored, and replaced when saving.
+     *
+     * \param[in] path the path of the file.
+     *
+     * \return true if the file was read.
+     */
+    bool open(const std::string& path);
+
+    /**
+     * Writes the positions of the file and the ones added since it was
+     * opened to the file, then maps it again. Does nothing if no file was
+     * opened.
+     *
+     * \return true if the file was written.
+     */
+    bool save();
+
+    /**
+     * Looks a position up. Safe to call from multiple threads at the same
+     * time, but not together with SolutionCache::add.
+     *
+     * \param[in] state the position.
+     *
+     * \param[out] winner the team that wins the position.
+     *
+     * \param[out] move the move that was best for the side to move,
+     *                  Location() if none is known.
+     *
+     * \return true if the position is solved.
+     */
+    bool probe(const Bitboard& state, Who& winner, Location& move) const;
+
+    /**
+     * Adds a solved position, as stored in the transposition table (see
+     * TranspositionTable::for_each_proven).
+     *
+     * \param[in] key the key of the position.
+     *
+     * \param[in] winner the team that wins the position.
+     *
+     * \param[in] move the grid the move starts at, or a grid outside of the
+     *                 board if none.
+     */
+    void add(const std::uint64_t key, const Who winner, const unsigned move);
+
+    /**
+     * \return the number of positions in the file and added since.
+     */
+    size_t size() const { return count + added.size(); }
+
+private:
+    struct Header {
+        char magic[8];
+        std::uint32_t rows, cols;
+        std::uint64_t count;
+    };
+
+    /* Identifies the file and the version of its format */
+    static const char MAGIC[8];
+
+    /* In the byte of a position, set if AWAY wins. The rest is the move. */
+    static const std::uint8_t AWAY_WINS = 0x80;
+    static const std::uint8_t NO_MOVE = 0x7f;
+
+    std::string path;
+
+    /* Size of the boards, the keys depend on it */
+    unsigned rows, cols;
+
+    /* The file mapped into memory */
+    void* mapping = nullptr;
+    size_t mapping_size = 0;
+
+    /* The positions of the file */
+    const std::uint64_t* keys = nullptr;
+    const std::uint8_t* outcomes = nullptr;
+    size_t count = 0;
+
+    /* Positions added since the file was opened */
+    std::unordered_map<std::uint64_t, std::uint8_t> added;
+
+    /**
+     * Unmaps the file. The path is kept for SolutionCache::save.
+     */
+    void close();
+
+    /**
+     * Looks a key up in the file and among the positions added since.
+     *
+     * \param[in] key the key.
+     *
+     * \param[out] outcome the byte of the position if found.
+     *
+     * \return true if found, false otherwise.
+     */
+    bool find(const std::uint64_t key, std::uint8_t& outcome) const;
+};
+
+#endif /* end of include guard */
+
+/* vim: tw=78:et:ts=4:sts=4:sw=4 */
@@ -23,12 +23,19 @@ float Timer::get_time_left() const {
     return time_left;
 }
 
+double Timer::now() {
+    timeval t;
+    gettimeofday(&t, NULL);
+    return t.tv_sec + (t.tv_usec / 1000000.0);
+}
+
 int Timer::get_moves_left() {
     return moves_left;
 }
 
 float Timer::get_move_time() {
-    return time_left / moves_left;
+    // Keep the budget finite when the game goes on longer than predicted
+    return time_left / (moves_left > 1 ? moves_left : 1);
 }
 
 int Timer::get_suggested_depth(const int b) {
@@ -44,6 +44,7 @@ class Timer {
     void click();
     float get_time();
     float get_time_left() const;
+    static double now();
     int get_moves_left();
     float get_move_time();
     int get_suggested_depth(int b);
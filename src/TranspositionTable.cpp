@@ -3,62 +3,85 @@
 using TPT = TranspositionTable;
 using score_t = Evaluator::score_t;
 
+namespace {
+    /**
+     * \return the score seen from the other team, keeping infinite scores
+     *         infinite.
+     */
+    score_t negate(const score_t score) {
+        if (score == std::numeric_limits<score_t>::max()) {
+            return std::numeric_limits<score_t>::min();
+        }
+        if (score == std::numeric_limits<score_t>::min()) {
+            return std::numeric_limits<score_t>::max();
+        }
+        return -score;
+    }
+}
+
 /* Constructors for TranspositionTable::Entry {{{ */
 TPT::Entry::Entry()
     : lower_limit{0}
     , upper_limit{0}
-    , nodes_searched{0}
+    , depth{0}
 { }
 
 TPT::Entry::Entry(const score_t lower_limit,
                   const score_t upper_limit,
-                  const long unsigned nodes_searched)
+                  const unsigned depth,
+                  const Location& best_move)
     : lower_limit{lower_limit}
     , upper_limit{upper_limit}
-    , nodes_searched{nodes_searched}
+    , depth{depth}
+    , best_move{best_move}
 { }
 
 TPT::Entry::Entry(const TPT::Entry& other)
     : lower_limit{other.lower_limit}
     , upper_limit{other.upper_limit}
-    , nodes_searched{other.nodes_searched}
+    , depth{other.depth}
+    , best_move{other.best_move}
 { }
 
 TPT::Entry::Entry(TPT::Entry&& other)
     : lower_limit{std::move(other.lower_limit)}
     , upper_limit{std::move(other.upper_limit)}
-    , nodes_searched{std::move(other.nodes_searched)}
+    , depth{std::move(other.depth)}
+    , best_move{std::move(other.best_move)}
 { }
 
 TPT::Entry& TPT::Entry::operator=(const Entry& other) {
     lower_limit = other.lower_limit;
     upper_limit = other.upper_limit;
-    nodes_searched = other.nodes_searched;
+    depth = other.depth;
+    best_move = other.best_move;
     return *this;
 }
 
 TPT::Entry& TPT::Entry::operator=(Entry&& other) {
     lower_limit = std::move(other.lower_limit);
     upper_limit = std::move(other.upper_limit);
-    nodes_searched = std::move(other.nodes_searched);
+    depth = std::move(other.depth);
+    best_move = std::move(other.best_move);
     return *this;
 }
 /* }}} */
 
 /* Constructors, Destructor, and Assignment operator {{{ */
 // Default constructor
-TPT::TranspositionTable()
-{ }
+TPT::TranspositionTable(const size_t megabytes) {
+    resize(megabytes);
+}
 
 // Copy constructor
-TPT::TranspositionTable(const TPT& other)
-    : table{other.table}
-{ }
+TPT::TranspositionTable(const TPT& other) {
+    *this = other;
+}
 
 // Move constructor
-TPT::TranspositionTable(TPT&& other)
-    : table{std::move(other.table)}
-{ }
+TPT::TranspositionTable(TPT&& other) {
+    *this = std::move(other);
+}
 
 // Destructor
 TPT::~TranspositionTable()
@@ -66,151 +89,214 @@ TPT::~TranspositionTable()
 
 // Assignment operator
 TPT& TPT::operator=(const TPT& other) {
-    table = other.table;
+    if (this != &other) {
+        allocate(other.bucket_count);
+        for (size_t i = 0; i < bucket_count; i++) {
+            for (unsigned j = 0; j < BUCKET_SIZE; j++) {
+                const Slot& from = other.buckets[i].slots[j];
+                Slot& to = buckets[i].slots[j];
+                to.check.store(from.check.load(std::memory_order_relaxed),
+                               std::memory_order_relaxed);
+                to.data.store(from.data.load(std::memory_order_relaxed),
+                              std::memory_order_relaxed);
+            }
+        }
+        generation.store(other.generation.load());
+    }
     return *this;
 }
 
 TPT& TPT::operator=(TPT&& other) {
-    table = std::move(other.table);
+    memory = std::move(other.memory);
+    buckets = other.buckets;
+    bucket_count = other.bucket_count;
+    generation.store(other.generation.load());
+    other.buckets = nullptr;
+    other.bucket_count = 0;
     return *this;
 }
 /* }}} */
 
-std::pair<TPT::Entry, bool> TPT::check(const DomineeringState& state) {
-    DomineeringState state_copy{state};
-
-    // Original position
-    auto it = table.find(state);
-    if (it != table.end()) {
-        return std::make_pair(it->second, true);
-    }
-
-    flip_horizontal(state_copy);
-
-    // Horizontal
-    it = table.find(state);
-    if (it != table.end()) {
-        return std::make_pair(it->second, true);
-    }
-
-    // Horizontal AND vertical
-    flip_vertical(state_copy);
-    it = table.find(state);
-    if (it != table.end()) {
-        return std::make_pair(it->second, true);
+void TPT::clear() {
+    for (size_t i = 0; i < bucket_count; i++) {
+        for (Slot& slot : buckets[i].slots) {
+            slot.check.store(0, std::memory_order_relaxed);
+            slot.data.store(0, std::memory_order_relaxed);
+        }
     }
+    generation.store(0);
+}
 
-    // Vertical
-    // Revert the horizontal flip
-    flip_horizontal(state_copy);
-    it = table.find(state);
-    if (it != table.end()) {
-        return std::make_pair(it->second, true);
+void TPT::resize(const size_t megabytes) {
+    // The largest power of two that fits, but at least one bucket
+    const size_t fit = megabytes * BYTES_PER_MEGABYTE / sizeof(Bucket);
+    size_t count = 1;
+    while (count * 2 <= fit) {
+        count *= 2;
     }
+    allocate(count);
+}
 
-    // No match
-    return std::make_pair(Entry(), false);
+void TPT::age() {
+    // Ages are told by the difference of generations, which survives the
+    // counter wrapping around
+    ++generation;
 }
 
-void TPT::shrink() {
-    // Key-Value type
-    using k_v_t = std::pair<
-        decltype(table)::key_type,
-        decltype(table)::mapped_type
-    >;
-    // Move all entries into a vector and sort
-    std::vector<k_v_t> tmp;
-    tmp.resize(table.size());
-    std::move(table.begin(), table.end(), tmp.begin());
-    // Sort so that the largest nodes_searched comes first
-    std::sort(tmp.begin(), tmp.end(), [](const k_v_t& a, const k_v_t& b) {
-              return a.second.nodes_searched > b.second.nodes_searched;
-              });
-    // Shrink and destroy entries
-    tmp.resize(TP_MAX * SHRINK_RATE);
-    // Them move them back to the table
-    for (auto&& p : std::move(tmp)) {
-        table.insert(p);
+std::pair<TPT::Entry, bool> TPT::check(const Bitboard& state) const {
+    std::uint64_t key, data;
+    const unsigned symmetry = state.canonical(key);
+
+    if (find(key, data)) {
+        return std::make_pair(unpack(data, state, symmetry), true);
     }
+    return std::make_pair(Entry(), false);
 }
 
-void TPT::insert(const DomineeringState& state,
+void TPT::insert(const Bitboard& state,
                  const score_t lower_limit,
                  const score_t upper_limit,
-                 const long unsigned nodes_searched) {
-    // Check table size first
-    if (table.size() > TPT::TP_MAX && TPT::TP_MAX != 0) {
-        shrink();
-    }
-    else {
-        table[state] = Entry(lower_limit, upper_limit, nodes_searched);
+                 const unsigned depth,
+                 const Location& best_move) {
+    std::uint64_t key;
+    const unsigned symmetry = state.canonical(key);
+    Slot* slots = buckets[bucket_of(key)].slots;
+    const std::uint16_t current = generation.load(std::memory_order_relaxed);
+
+    // Empty slots go first, then the entry whose draft is the lowest once
+    // it is reduced for every search since it was written, so that the
+    // deep entries of the last few searches stay. Another thread may be
+    // writing the bucket at the same time; at worst a slot ends up torn and
+    // is ignored by TranspositionTable::find.
+    Slot* victim = nullptr;
+    long victim_value = std::numeric_limits<long>::max();
+    for (unsigned i = 0; i < BUCKET_SIZE; i++) {
+        const std::uint64_t check =
+            slots[i].check.load(std::memory_order_relaxed);
+        const std::uint64_t data =
+            slots[i].data.load(std::memory_order_relaxed);
+        const long old_depth = (data >> 32) & 0xff;
+
+        if ((check ^ data) == key) {
+            // A deeper bound of the same state is worth more than a
+            // shallower one, unless the new score is exact
+            if (old_depth > depth && lower_limit != upper_limit) {
+                return;
+            }
+            victim = &slots[i];
+            break;
+        }
+
+        long value = std::numeric_limits<long>::min();
+        if (check != 0 || data != 0) {
+            const std::uint16_t age =
+                current - static_cast<std::uint16_t>(data >> 48);
+            value = old_depth - AGE_PENALTY * std::min<long>(age, 0xff);
+        }
+        if (value < victim_value) {
+            victim = &slots[i];
+            victim_value = value;
+        }
     }
+
+    const std::uint64_t data = pack(
+        Entry(lower_limit, upper_limit, depth, best_move), state, symmetry);
+    victim->check.store(key ^ data, std::memory_order_relaxed);
+    victim->data.store(data, std::memory_order_relaxed);
 }
 
 /* Private methods */
 
-void TPT::flip_horizontal(DomineeringState& state) {
-    for (unsigned i = 0; i < state.ROWS; i++) {
-        for (unsigned j = 0; j < state.COLS / 2; j++) {
-            // Row to swap
-            unsigned k = state.ROWS - 1 - i;
-            char a = state.getCell(i, j);
-            char b = state.getCell(k, j);
-            state.setCell(i, j, b);
-            state.setCell(k, j, a);
-        }
+void TPT::allocate(const size_t count) {
+    // One extra bucket of memory to align them to cache lines
+    memory.reset(new char[(count + 1) * sizeof(Bucket)]);
+    const std::uintptr_t address =
+        reinterpret_cast<std::uintptr_t>(memory.get());
+    buckets = reinterpret_cast<Bucket*>(
+        (address + alignof(Bucket) - 1) & ~(alignof(Bucket) - 1));
+    bucket_count = count;
+    for (size_t i = 0; i < bucket_count; i++) {
+        new (&buckets[i]) Bucket();
     }
+    clear();
 }
 
-void TPT::flip_vertical(DomineeringState& state) {
-    for (unsigned i = 0; i < state.ROWS; i++) {
-        for (unsigned j = 0; j < state.COLS / 2; j++) {
-            // Column to swap
-            unsigned k = state.COLS - 1 - j;
-            char a = state.getCell(i, j);
-            char b = state.getCell(i, k);
-            state.setCell(i, j, b);
-            state.setCell(i, k, a);
-        }
+std::uint64_t TPT::pack(const Entry& entry,
+                        const Bitboard& state,
+                        const unsigned symmetry) const {
+    // The limits are infinite for proven wins and losses, which are stored
+    // as the ends of the 16-bit range
+    auto pack_score = [](const score_t score) {
+        using limits = std::numeric_limits<std::int16_t>;
+        const score_t clamped = std::max<score_t>(
+            std::min<score_t>(score, limits::max()), limits::min());
+        return static_cast<std::uint64_t>(
+            static_cast<std::uint16_t>(static_cast<std::int16_t>(clamped)));
+    };
+
+    // Both the bounds and the move are stored as seen through the symmetry
+    score_t lower_limit = entry.lower_limit;
+    score_t upper_limit = entry.upper_limit;
+    if (Bitboard::swaps_teams(symmetry)) {
+        lower_limit = negate(entry.upper_limit);
+        upper_limit = negate(entry.lower_limit);
     }
+
+    const std::uint64_t move = entry.best_move == Location()
+        ? NO_MOVE
+        : state.transform_move(symmetry, entry.best_move);
+    const std::uint64_t depth = std::min(entry.depth, 0xffu);
+
+    return pack_score(lower_limit)
+        | pack_score(upper_limit) << 16
+        | depth << 32
+        | move << 40
+        | std::uint64_t{generation.load(std::memory_order_relaxed)} << 48;
 }
 
-void TPT::rotate_ccw(DomineeringState& state) {
-    unsigned f = std::floor(state.ROWS / 2);
-    unsigned c = std::ceil(state.ROWS / 2);
-    for (unsigned i = 0; i < f; i++) {
-        for (unsigned j = 0; j < c; j++) {
-            unsigned k = state.COLS - 1 - i;
-            unsigned l = state.COLS - 1 - j;
-            char a = state.getCell(i, j);
-            char b = state.getCell(j, k);
-            char c = state.getCell(k, l);
-            char d = state.getCell(l, i);
-            state.setCell(i, j, b);
-            state.setCell(j, k, c);
-            state.setCell(k, l, d);
-            state.setCell(l, i, a);
+TPT::Entry TPT::unpack(const std::uint64_t data,
+                       const Bitboard& state,
+                       const unsigned symmetry) const {
+    auto unpack_score = [](const std::uint64_t bits) -> score_t {
+        const std::int16_t score = static_cast<std::int16_t>(bits & 0xffff);
+        if (score == std::numeric_limits<std::int16_t>::max()) {
+            return std::numeric_limits<score_t>::max();
         }
+        if (score == std::numeric_limits<std::int16_t>::min()) {
+            return std::numeric_limits<score_t>::min();
+        }
+        return score;
+    };
+
+    Entry entry;
+    entry.depth = (data >> 32) & 0xff;
+
+    const unsigned move = (data >> 40) & 0xff;
+    if (move != NO_MOVE) {
+        entry.best_move = state.restore_move(symmetry, move);
+    }
+
+    entry.lower_limit = unpack_score(data);
+    entry.upper_limit = unpack_score(data >> 16);
+    if (Bitboard::swaps_teams(symmetry)) {
+        std::swap(entry.lower_limit, entry.upper_limit);
+        entry.lower_limit = negate(entry.lower_limit);
+        entry.upper_limit = negate(entry.upper_limit);
     }
+    return entry;
 }
 
-void TPT::rotate_cw(DomineeringState& state) {
-    unsigned f = std::floor(state.ROWS / 2);
-    unsigned c = std::ceil(state.ROWS / 2);
-    for (unsigned i = 0; i < f; i++) {
-        for (unsigned j = 0; j < c; j++) {
-            unsigned k = state.COLS - 1 - i;
-            unsigned l = state.COLS - 1 - j;
-            char a = state.getCell(i, j);
-            char b = state.getCell(j, k);
-            char c = state.getCell(k, l);
-            char d = state.getCell(l, i);
-            state.setCell(i, j, d);
-            state.setCell(j, k, a);
-            state.setCell(k, l, b);
-            state.setCell(l, i, c);
+bool TPT::find(const std::uint64_t key, std::uint64_t& data) const {
+    for (const Slot& slot : buckets[bucket_of(key)].slots) {
+        const std::uint64_t check =
+            slot.check.load(std::memory_order_relaxed);
+        data = slot.data.load(std::memory_order_relaxed);
+        // A slot written by two threads at once no longer matches any key
+        if ((check ^ data) == key && (check != 0 || data != 0)) {
+            return true;
         }
     }
+    return false;
 }
 
 /* vim: tw=78:et:ts=4:sts=4:sw=4 */
@@ -1,71 +1,111 @@
 #ifndef TRANSPOSITION_TABLE_H_
 #define TRANSPOSITION_TABLE_H_
 
-#include "DomineeringState.h"
+#include "Bitboard.h"
 #include "Evaluators.h"
+#include "Location.h"
 
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <cmath>
+#include <cstdint>
 #include <fstream>
+#include <limits>
+#include <memory>
+#include <new>
 #include <string>
-#include <unordered_map>
 #include <utility>
 #include <vector>
 
 using score_t = Evaluator::score_t;
 
+/**
+ * A fixed-size transposition table. Entries are packed into 16 bytes and
+ * grouped into buckets of one cache line, so that a lookup touches a single
+ * cache line and the table never has to be shrunk. When a bucket is full,
+ * the least valuable entry in it is replaced.
+ *
+ * Threads probe and store without locking. Each slot keeps the key XORed
+ * with the data, so a slot that was torn by two threads writing it at the
+ * same time no longer matches its key and reads as a miss instead of
+ * returning another state's bounds.
+ */
 class TranspositionTable {
 public:
     /**
      * A simple struct that represents an entry in the transposition table.
-     * The `nodes_searched' member variable is used when deleting old elements
-     * when the table gets too large.
+     * The limits tell the kind of bound: the score is exact if they are
+     * equal, at least `lower_limit' if the search failed high (`upper_limit'
+     * is POS_INF), and at most `upper_limit' if it failed low.
+     * `depth' is the draft, the number of plies that were searched below the
+     * state. The bounds only hold for searches of at most that many plies,
+     * unless they prove the outcome of the game.
+     * `best_move' is the child that gave the bound, Location() if none.
      */
     struct Entry {
         Entry();
         Entry(const score_t lower_limit,
               const score_t upper_limit,
-              const long unsigned nodes_searched);
+              const unsigned depth,
+              const Location& best_move);
         Entry(const Entry& other);
         Entry(Entry&& other);
 
         Entry& operator=(const Entry& other);
         Entry& operator=(Entry&& other);
 
+        /**
+         * \return true if the bounds hold for a search of the given number
+         *         of plies below the state.
+         */
+        bool usable(const unsigned draft) const {
+            return depth >= draft || proven();
+        }
+
+        /**
+         * \return true if a team is known to win: no matter how deep the
+         *         state is searched, the score is infinite.
+         */
+        bool proven() const {
+            return lower_limit == std::numeric_limits<score_t>::max()
+                || upper_limit == std::numeric_limits<score_t>::min();
+        }
+
         score_t lower_limit, upper_limit;
-        long unsigned nodes_searched;
+        unsigned depth;
+        Location best_move;
     };
 
-    // Declare type of table here so that key-value size can be calculated
-    using table_t = std::unordered_map<DomineeringState, Entry>;
-
     /**
-     * Maximum memory we should use in megabytes.
+     * Size of the table in megabytes if none is given.
      */
-    static const unsigned MEM_LIMIT = 500;
+    static const unsigned DEFAULT_MEGABYTES = 64;
 
     static const unsigned BYTES_PER_MEGABYTE = 1024 * 1024;
 
     /**
-     * The amount of memory it takes for one entry in bytes.
-     * Estimated by adding the size of hash key and value.
+     * Number of entries in one bucket, which fills one cache line.
      */
-    static constexpr size_t BYTES_PER_ENTRY =
-        sizeof(typename table_t::value_type);
+    static const unsigned BUCKET_SIZE = 4;
 
     /**
-     * Maximum number of entries to store in the transposition table.
-     * 0 for unlimited.
+     * Plies of draft an entry is worth less for every search since it was
+     * written, when deciding which entry of a full bucket to replace. There
+     * are two searches a move, ours and the one while pondering.
      */
-    static constexpr unsigned TP_MAX =
-        MEM_LIMIT * BYTES_PER_MEGABYTE / BYTES_PER_ENTRY;
+    static const unsigned AGE_PENALTY = 2;
 
     /**
-     * How much entries to get rid of in one shrink.
+     * Stored in place of the grid of the best move when there is none.
      */
-    static constexpr float SHRINK_RATE = 0.8;
+    static const unsigned NO_MOVE = 0xff;
 
-    TranspositionTable();
+    /**
+     * \param[in] megabytes the memory to use. Rounded down to a power of
+     *                      two number of buckets.
+     */
+    TranspositionTable(const size_t megabytes = DEFAULT_MEGABYTES);
 
     TranspositionTable(const TranspositionTable& other);
 
@@ -83,29 +123,48 @@ public:
     void clear();
 
     /**
-     * Shrinks the transposition table by removing entries that have smaller
-     * searched nodes count.
+     * Changes the size of the table. Clears it.
+     *
+     * \param[in] megabytes the memory to use.
      */
-    void shrink();
+    void resize(const size_t megabytes);
 
     /**
-     * Checks for existence in the transposition table.
-     * If the given state is not a hit, this method will try to find the same
-     * transposition of the state (vertically and horizontally symmetrical).
+     * \return the number of entries the table can hold.
+     */
+    size_t capacity() const { return bucket_count * BUCKET_SIZE; }
+
+    /**
+     * Marks every entry as one search older. Older entries are replaced
+     * first when a bucket is full, but are still found until then, so the
+     * table does not have to be cleared between moves. To be called before
+     * each search. Takes constant time: entries are told apart by the
+     * generation they were written in.
+     */
+    void age();
+
+    /**
+     * Checks for existence in the transposition table. Safe to call from
+     * multiple threads at the same time.
+     * A state and its mirror images share one entry, and so do the images
+     * of a square board with rows and columns swapped and the other team to
+     * move, whose score is negated. See Bitboard::canonical.
      *
      * \param[in] state the state to check
      *
      * \return a std::pair<score_t, bool> where the first element is the score
      *         and the second element is true if there was a hit in any of the
-     *         transposition, false otherwise.
+     *         transposition, false otherwise. The bounds and the best move
+     *         are those of the given state.
      */
-    std::pair<Entry, bool> check(const DomineeringState& state);
+    std::pair<Entry, bool> check(const Bitboard& state) const;
 
     /**
      * Adds the current state and the resulting score to the transposition
-     * table.
-     * If the number of entries in the table exceeds a threashold, some
-     * entries in the transposition table are deleted.
+     * table. Safe to call from multiple threads at the same time.
+     * The entry of the same state is replaced unless it is deeper and the
+     * new score is not exact. If the bucket of the state is full, the entry
+     * of another state with the least depth for its age is replaced.
      *
      * \param[in] state the current state.
      *
@@ -115,57 +174,139 @@ public:
      * \param[in] upper_limit the highest possible score that is guarenteed to
      *                        be found when further searching down the tree.
      *
-     * \param[in] nodes_searched the number of nodes searched up to the point
-     *            of insertion. This is used when the table gets too large and
-     *            needs to be shrunk.
+     * \param[in] depth the number of plies searched below the state.
+     *
+     * \param[in] best_move the move to the best child, or the one that caused
+     *                      a cutoff.
      */
-    void insert(const DomineeringState& state,
+    void insert(const Bitboard& state,
                 const score_t lower_limit,
                 const score_t upper_limit,
-                const long unsigned nodes_searched);
+                const unsigned depth,
+                const Location& best_move);
+
+    /**
+     * Calls f(key, winner, move) for every entry that proves which team
+     * wins. The entry is given as it is stored, seen through the symmetry
+     * of its key (see Bitboard::canonical): `winner' is the team that wins
+     * there, and `move' the grid its best move starts at or NO_MOVE.
+     * Entries written while the function runs may or may not be visited.
+     */
+    template <typename F>
+    void for_each_proven(F f) const;
 
 private:
     /**
-     * The transposition table.
-     * This table is used to look up board configurations that have already
-     * been explored.
-     *
-     * Key: the state.
-     * Val: a pair of resulting score and the move number this entry was added.
+     * One entry as it is stored. `data' holds, from the lowest bits: the
+     * lower and upper limits (16 bits each), the depth and the grid the best
+     * move starts at (8 bits each), and the generation (16 bits). `check'
+     * is the key XORed with the data. A slot whose words are both 0 is
+     * empty. The words are read and written separately with relaxed
+     * atomics, which are plain loads and stores on x86.
+     */
+    struct Slot {
+        std::atomic<std::uint64_t> check{0};
+        std::atomic<std::uint64_t> data{0};
+    };
+
+    struct alignas(64) Bucket {
+        Slot slots[BUCKET_SIZE];
+    };
+
+
+    /**
+     * Memory of the table, with room to align the buckets to cache lines.
      */
-    table_t table;
+    std::unique_ptr<char[]> memory;
+
+    Bucket* buckets = nullptr;
 
     /**
-     * Flips the board horizontally (along the x-axis).
-     *
-     * \param[out] state the state to be flipped.
+     * Number of buckets, a power of two.
+     */
+    size_t bucket_count = 0;
+
+    /**
+     * Entries written before the last call to TranspositionTable::age have
+     * a different generation.
+     */
+    std::atomic<std::uint16_t> generation{0};
+
+    /**
+     * Allocates the given number of empty buckets.
      */
-    void flip_horizontal(DomineeringState& state);
+    void allocate(const size_t count);
 
     /**
-     * Flips the board vertically (along the y-axis).
+     * \return the index of the bucket the key belongs to.
+     */
+    size_t bucket_of(const std::uint64_t key) const {
+        return key & (bucket_count - 1);
+    }
+
+    /**
+     * Packs the entry into the data of a slot.
+     *
+     * \param[in] entry the entry to pack.
+     *
+     * \param[in] state the state of the entry.
      *
-     * \param[out] state the state to be flipped.
+     * \param[in] symmetry the symmetry the entry is stored through.
      */
-    void flip_vertical(DomineeringState& state);
+    std::uint64_t pack(const Entry& entry,
+                       const Bitboard& state,
+                       const unsigned symmetry) const;
 
     /**
-     * Rotates the board counter-clockwise 90 degrees.
+     * Unpacks the data of a slot.
      *
-     * \param[out] state the state to be rotated.
+     * \param[in] data the data of the slot.
+     *
+     * \param[in] state the state of the entry.
+     *
+     * \param[in] symmetry the symmetry the entry was stored through.
      */
-    void rotate_ccw(DomineeringState& state);
+    Entry unpack(const std::uint64_t data,
+                 const Bitboard& state,
+                 const unsigned symmetry) const;
 
     /**
-     * Rotates the board clockwise 90 degrees.
+     * Looks up a key in the table.
+     *
+     * \param[in] key the key.
      *
-     * \param[out] state the state to be rotated.
+     * \param[out] data the data of the slot if found.
+     *
+     * \return true if found, false otherwise.
      */
-    void rotate_cw(DomineeringState& state);
+    bool find(const std::uint64_t key, std::uint64_t& data) const;
 };
 
-inline void TranspositionTable::clear() {
-    table.clear();
+template <typename F>
+void TranspositionTable::for_each_proven(F f) const {
+    using limits = std::numeric_limits<std::int16_t>;
+    for (size_t i = 0; i < bucket_count; i++) {
+        for (const Slot& slot : buckets[i].slots) {
+            const std::uint64_t check =
+                slot.check.load(std::memory_order_relaxed);
+            const std::uint64_t data =
+                slot.data.load(std::memory_order_relaxed);
+            if (check == 0 && data == 0) {
+                continue;
+            }
+
+            // Infinite limits are packed as the ends of the 16-bit range
+            const std::int16_t lower = data & 0xffff;
+            const std::int16_t upper = data >> 16 & 0xffff;
+            const unsigned move = data >> 40 & 0xff;
+            if (lower == limits::max()) {
+                f(check ^ data, Who::HOME, move);
+            }
+            else if (upper == limits::min()) {
+                f(check ^ data, Who::AWAY, move);
+            }
+        }
+    }
 }
 
 #endif /* end of include guard */
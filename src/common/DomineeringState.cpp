@@ -52,12 +52,12 @@ Status DomineeringState::thisGameCheckTerminalUpdateStatus() {
     if (getWho() == Who::HOME) {
         int c = -1;
         return std::any_of(board.begin(), board.end(), [&](const char &ch) {
-            c = c == 8 ? 0 : c+1;
+            c = c == COLS-1 ? 0 : c+1;
             return ch == EMPTYSYM && c+1 != COLS && *(&ch+1) == EMPTYSYM;
         }) ? Status::GAME_ON : Status::AWAY_WIN;
     } else {
         return std::any_of(board.begin(), board.end(), [&](char &ch) {
-            return ch == EMPTYSYM && &ch - board.data() + COLS <= ROWS*COLS
+            return ch == EMPTYSYM && &ch - board.data() + COLS < ROWS*COLS
                    && *(&ch+COLS) == EMPTYSYM;
         }) ? Status::GAME_ON : Status::HOME_WIN;
     }
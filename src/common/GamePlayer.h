@@ -66,7 +66,7 @@ public:
      * should come shortly thereafter. Default behavior is to do nothing.
      * @param opponent Name of the opponent being played
      */
-    inline void startGame(std::string opponentName) { }
+    virtual inline void startGame(std::string opponentName) { }
     
     /**
      * Called to inform the player how long the last move took. This can
@@ -0,0 +1,432 @@
+#include "MctsSearcher.h"
+#include "Searcher.h"
+#include "Timer.h"
+#include "TranspositionTable.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * Benchmarks for the searcher. Run from the build directory so that the
+ * config directory is found.
+ *
+ * Usage: bench smp|ybwc [depth] [max threads] [positions] [plies]
+ *        bench ordering [depth] [positions] [plies]
+ *        bench table [max threads] [operations]
+ *        bench mcts [seconds] [max threads] [positions] [plies]
+ *        bench versus [seconds] [games] [plies] [threads]
+ */
+
+/**
+ * Plays random moves from the initial position.
+ *
+ * \param[in] seed seed of the random number generator.
+ *
+ * \param[in] plies the number of moves to play.
+ *
+ * \return the resulting state.
+ */
+DomineeringState random_position(const unsigned seed, const unsigned plies) {
+    DomineeringState state;
+    std::mt19937 rng(seed);
+
+    for (unsigned i = 0; i < plies; i++) {
+        std::vector<DomineeringMove> moves;
+        for (int r = 0; r < state.ROWS; r++) {
+            for (int c = 0; c < state.COLS; c++) {
+                DomineeringMove m = state.getWho() == Who::HOME
+                    ? DomineeringMove(r, c, r, c + 1)
+                    : DomineeringMove(r, c, r + 1, c);
+                if (state.moveOK(m)) {
+                    moves.push_back(m);
+                }
+            }
+        }
+        if (moves.empty()) {
+            break;
+        }
+        state.makeMove(moves[rng() % moves.size()]);
+    }
+
+    return state;
+}
+
+/**
+ * Measures the time it takes to search every position to the given depth
+ * with 1, 2, 4, ... threads.
+ */
+void bench_parallel(const Searcher::Parallelism parallelism,
+                    const unsigned depth,
+                    const unsigned max_threads,
+                    const unsigned positions,
+                    const unsigned plies) {
+    std::vector<DomineeringState> states;
+    for (unsigned i = 0; i < positions; i++) {
+        states.push_back(random_position(i, plies));
+    }
+
+    // Powers of two up to the maximum, and the maximum itself
+    std::vector<unsigned> thread_counts;
+    for (unsigned threads = 1; threads < max_threads; threads *= 2) {
+        thread_counts.push_back(threads);
+    }
+    thread_counts.push_back(max_threads);
+
+    std::cout << "threads\ttime\tspeedup\tnodes" << std::endl;
+    float base_time = 0;
+    for (const unsigned threads : thread_counts) {
+        float time = 0;
+        long unsigned nodes = 0;
+
+        for (const DomineeringState& state : states) {
+            Searcher searcher;
+            searcher.set_mode(Searcher::Mode::PVS);
+            searcher.set_parallelism(parallelism);
+            searcher.set_threads(threads);
+            // Only the depth limits the search
+            searcher.set_move_time(1e9);
+
+            Timer timer;
+            timer.click();
+            searcher.search(state, depth);
+            timer.click();
+
+            time += timer.get_time();
+            nodes += searcher.get_nodes_searched();
+        }
+
+        if (threads == 1) {
+            base_time = time;
+        }
+        std::cout << threads << "\t" << time << "\t"
+            << base_time / time << "\t" << nodes << std::endl;
+    }
+}
+
+/**
+ * Counts the nodes visited at every depth when searching every position to
+ * the given depth, with and without the killer and history heuristics.
+ */
+void bench_ordering(const unsigned depth,
+                    const unsigned positions,
+                    const unsigned plies) {
+    std::vector<long unsigned> nodes[2];
+    float time[2] = {0, 0};
+
+    for (unsigned i = 0; i < positions; i++) {
+        const DomineeringState state = random_position(i, plies);
+
+        for (int ordered = 0; ordered < 2; ordered++) {
+            Searcher searcher;
+            searcher.set_mode(Searcher::Mode::PVS);
+            searcher.set_move_ordering(ordered);
+            // Only the depth limits the search
+            searcher.set_move_time(1e9);
+
+            Timer timer;
+            timer.click();
+            searcher.search(state, depth);
+            timer.click();
+            time[ordered] += timer.get_time();
+
+            const auto& per_depth = searcher.get_nodes_per_depth();
+            if (nodes[ordered].size() < per_depth.size()) {
+                nodes[ordered].resize(per_depth.size());
+            }
+            for (size_t d = 0; d < per_depth.size(); d++) {
+                nodes[ordered][d] += per_depth[d];
+            }
+        }
+    }
+
+    std::cout << "depth\tunordered\tordered\tratio" << std::endl;
+    long unsigned total[2] = {0, 0};
+    for (size_t d = 0; d < nodes[0].size(); d++) {
+        const long unsigned ordered = d < nodes[1].size() ? nodes[1][d] : 0;
+        total[0] += nodes[0][d];
+        total[1] += ordered;
+        std::cout << d << "\t" << nodes[0][d] << "\t" << ordered << "\t"
+            << static_cast<float>(ordered) / nodes[0][d] << std::endl;
+    }
+    std::cout << "total\t" << total[0] << "\t" << total[1] << "\t"
+        << static_cast<float>(total[1]) / total[0] << std::endl;
+    std::cout << "time\t" << time[0] << "\t" << time[1] << "\t"
+        << time[1] / time[0] << std::endl;
+}
+
+/**
+ * The entry stored for a board by bench_table, so that any entry read back
+ * can be checked against the board it was found for.
+ */
+TranspositionTable::Entry table_entry(const Bitboard& state) {
+    const Bitboard::bits_t key = state.key();
+    const score_t lower = static_cast<score_t>(key & 0x3ff) - 512;
+    const score_t upper = lower + static_cast<score_t>(key >> 10 & 0xff);
+    return TranspositionTable::Entry(lower, upper, key >> 20 & 0x3f,
+                                     Location());
+}
+
+/**
+ * \return the given number of boards with random grids covered and a random
+ *         team to move.
+ */
+std::vector<Bitboard> random_boards(const unsigned count) {
+    std::vector<Bitboard> boards(count);
+    std::mt19937_64 rng(count);
+    for (Bitboard& board : boards) {
+        board.home = rng() & board.empty();
+        board.away = rng() & board.empty();
+        board.who = rng() & 1 ? Who::HOME : Who::AWAY;
+        board.rehash();
+    }
+    return boards;
+}
+
+/**
+ * Runs the given number of threads, each of which probes and stores random
+ * boards in the table, half of the operations each. Every entry found is
+ * checked against the one stored for its board.
+ *
+ * \param[in] boards the boards to pick from.
+ *
+ * \return the number of entries found that did not belong to their board.
+ */
+long unsigned hammer_table(TranspositionTable& table,
+                           const unsigned threads,
+                           const long unsigned operations,
+                           const std::vector<Bitboard>& boards) {
+    std::atomic<long unsigned> corrupt{0};
+    std::vector<std::thread> workers;
+
+    for (unsigned t = 0; t < threads; t++) {
+        workers.emplace_back([&, t] {
+            std::mt19937_64 rng(t);
+            long unsigned bad = 0;
+
+            for (long unsigned i = 0; i < operations; i++) {
+                const Bitboard& state = boards[rng() % boards.size()];
+                const TranspositionTable::Entry e = table_entry(state);
+                if (i & 1) {
+                    table.insert(state, e.lower_limit, e.upper_limit,
+                                 e.depth, e.best_move);
+                    continue;
+                }
+
+                const auto found = table.check(state);
+                if (found.second) {
+                    bad += found.first.lower_limit != e.lower_limit
+                        || found.first.upper_limit != e.upper_limit
+                        || found.first.depth != e.depth;
+                }
+            }
+            corrupt += bad;
+        });
+    }
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+
+    return corrupt;
+}
+
+/**
+ * Measures how many operations per second the transposition table takes
+ * with 1, 2, 4, ... threads on a table of the default size, then stresses a
+ * table of one bucket, where the threads keep overwriting each other's
+ * slots, and counts the entries read back that were corrupt.
+ */
+void bench_table(const unsigned max_threads,
+                 const long unsigned operations) {
+    std::vector<unsigned> thread_counts;
+    for (unsigned threads = 1; threads < max_threads; threads *= 2) {
+        thread_counts.push_back(threads);
+    }
+    thread_counts.push_back(max_threads);
+
+    TranspositionTable table;
+    TranspositionTable tiny(0);
+    const std::vector<Bitboard> boards = random_boards(1 << 16);
+    const std::vector<Bitboard> few_boards = random_boards(16);
+
+    std::cout << "threads\tMops/s\tspeedup\tcorrupt" << std::endl;
+    float base_rate = 0;
+    for (const unsigned threads : thread_counts) {
+        table.clear();
+        const double start = Timer::now();
+        long unsigned corrupt =
+            hammer_table(table, threads, operations, boards);
+        const double time = Timer::now() - start;
+        const float rate = threads * operations / time / 1e6;
+        if (base_rate == 0) {
+            base_rate = rate;
+        }
+
+        tiny.clear();
+        corrupt += hammer_table(tiny, threads, operations, few_boards);
+
+        std::cout << threads << "\t" << rate << "\t" << rate / base_rate
+            << "\t" << corrupt << std::endl;
+    }
+}
+
+/**
+ * Measures how many playouts per second MCTS runs on every position with 1,
+ * 2, 4, ... threads, given the same time per position.
+ */
+void bench_mcts(const float seconds,
+                const unsigned max_threads,
+                const unsigned positions,
+                const unsigned plies) {
+    std::vector<unsigned> thread_counts;
+    for (unsigned threads = 1; threads < max_threads; threads *= 2) {
+        thread_counts.push_back(threads);
+    }
+    thread_counts.push_back(max_threads);
+
+    std::cout << "threads\tplayouts/s\tspeedup\tnodes" << std::endl;
+    double base_rate = 0;
+    for (const unsigned threads : thread_counts) {
+        long unsigned playouts = 0;
+        size_t nodes = 0;
+        double time = 0;
+
+        for (unsigned i = 0; i < positions; i++) {
+            MctsSearcher mcts;
+            mcts.set_threads(threads);
+            mcts.set_move_time(seconds);
+            mcts.search(random_position(i, plies));
+
+            playouts += mcts.get_playouts();
+            time += mcts.get_playouts() / mcts.get_playouts_per_second();
+            nodes += mcts.get_nodes();
+        }
+
+        const double rate = playouts / time;
+        if (threads == 1) {
+            base_rate = rate;
+        }
+        std::cout << threads << "\t" << rate << "\t" << rate / base_rate
+            << "\t" << nodes << std::endl;
+    }
+}
+
+/**
+ * Plays MCTS against alpha-beta with the same time per move and the same
+ * number of threads, from random positions a few plies in, each position
+ * twice with the engines swapping sides.
+ */
+void bench_versus(const float seconds,
+                  const unsigned games,
+                  const unsigned plies,
+                  const unsigned threads) {
+    unsigned mcts_wins = 0;
+    long unsigned playouts = 0;
+    double time = 0;
+
+    for (unsigned g = 0; g < games; g++) {
+        const Who mcts_team = g % 2 == 0 ? Who::HOME : Who::AWAY;
+        MctsSearcher mcts;
+        mcts.set_threads(threads);
+        mcts.set_move_time(seconds);
+        Searcher searcher;
+        searcher.set_mode(Searcher::Mode::PVS);
+        searcher.set_threads(threads);
+        searcher.set_move_time(seconds);
+
+        DomineeringState state = random_position(g / 2, plies);
+        while (Bitboard(state).moves(state.getWho()) != 0) {
+            Location move;
+            if (state.getWho() == mcts_team) {
+                move = mcts.search(state);
+                playouts += mcts.get_playouts();
+                time += mcts.get_playouts() / mcts.get_playouts_per_second();
+            }
+            else {
+                const unsigned depth =
+                    Bitboard::count(Bitboard(state).empty()) / 2;
+                move = searcher.search(state, depth).parent_move;
+            }
+            state.makeMove(move.to_move());
+        }
+        searcher.cleanup();
+
+        // The side left without a move loses
+        const bool won = state.getWho() != mcts_team;
+        mcts_wins += won;
+        std::cout << "game " << g << "\tMCTS "
+            << (mcts_team == Who::HOME ? "HOME" : "AWAY")
+            << (won ? "\twon" : "\tlost") << std::endl;
+    }
+
+    std::cout << "MCTS won " << mcts_wins << "/" << games << ", "
+        << static_cast<long unsigned>(time > 0 ? playouts / time : 0)
+        << " playouts/s" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    const std::string command = argc > 1 ? argv[1] : "";
+
+    if (command == "smp" || command == "ybwc") {
+        unsigned depth = argc > 2 ? std::atoi(argv[2]) : 7;
+        unsigned threads = argc > 3
+            ? std::atoi(argv[3])
+            : std::thread::hardware_concurrency();
+        unsigned positions = argc > 4 ? std::atoi(argv[4]) : 8;
+        unsigned plies = argc > 5 ? std::atoi(argv[5]) : 10;
+        bench_parallel(command == "smp"
+                       ? Searcher::Parallelism::LAZY_SMP
+                       : Searcher::Parallelism::YBWC,
+                       depth, threads, positions, plies);
+    }
+    else if (command == "ordering") {
+        unsigned depth = argc > 2 ? std::atoi(argv[2]) : 7;
+        unsigned positions = argc > 3 ? std::atoi(argv[3]) : 8;
+        unsigned plies = argc > 4 ? std::atoi(argv[4]) : 10;
+        bench_ordering(depth, positions, plies);
+    }
+    else if (command == "table") {
+        unsigned threads = argc > 2 ? std::atoi(argv[2]) : 32;
+        long unsigned operations = argc > 3 ? std::atol(argv[3]) : 4000000;
+        bench_table(threads, operations);
+    }
+    else if (command == "mcts") {
+        float seconds = argc > 2 ? std::atof(argv[2]) : 1;
+        unsigned threads = argc > 3
+            ? std::atoi(argv[3])
+            : std::thread::hardware_concurrency();
+        unsigned positions = argc > 4 ? std::atoi(argv[4]) : 8;
+        unsigned plies = argc > 5 ? std::atoi(argv[5]) : 10;
+        bench_mcts(seconds, threads, positions, plies);
+    }
+    else if (command == "versus") {
+        float seconds = argc > 2 ? std::atof(argv[2]) : 1;
+        unsigned games = argc > 3 ? std::atoi(argv[3]) : 10;
+        unsigned plies = argc > 4 ? std::atoi(argv[4]) : 4;
+        unsigned threads = argc > 5 ? std::atoi(argv[5]) : 1;
+        bench_versus(seconds, games, plies, threads);
+    }
+    else {
+        std::cerr << "Usage: " << argv[0]
+            << " smp|ybwc [depth] [max threads] [positions] [plies]"
+            << std::endl
+            << "       " << argv[0] << " ordering [depth] [positions] [plies]"
+            << std::endl
+            << "       " << argv[0] << " table [max threads] [operations]"
+            << std::endl
+            << "       " << argv[0]
+            << " mcts [seconds] [max threads] [positions] [plies]"
+            << std::endl
+            << "       " << argv[0]
+            << " versus [seconds] [games] [plies] [threads]" << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
+
+/* vim: tw=78:et:ts=4:sts=4:sw=4 */
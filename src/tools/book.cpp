@@ -0,0 +1,205 @@
+#include "Bitboard.h"
+#include "OpeningBook.h"
+#include "Searcher.h"
+#include "Timer.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+/**
+ * Builds the opening book: searches every position of the first plies of
+ * the game, one of each set of symmetric images, and writes the best moves
+ * to a file that Moderator probes before searching. Run from the build
+ * directory so that the config directory is found.
+ *
+ * Every position searched is appended to a checkpoint file next to the
+ * book, so a run that was stopped picks up where it left off when started
+ * again with the same arguments. Positions in the checkpoint that were
+ * searched less deep are searched again.
+ *
+ * Usage: book [plies] [depth] [threads] [file] [table megabytes]
+ */
+
+/**
+ * A position searched, as appended to the checkpoint file.
+ */
+struct Record {
+    std::uint64_t key;
+    OpeningBook::Entry entry;
+};
+
+/**
+ * \return one board for each position where a move is to be made in the
+ *         first plies of the game, without symmetric images, in the order
+ *         of the plies.
+ */
+std::vector<Bitboard> opening_positions(const unsigned plies) {
+    std::vector<Bitboard> positions;
+    std::unordered_set<std::uint64_t> seen;
+    std::vector<Bitboard> ply{Bitboard(DomineeringState())};
+
+    for (unsigned p = 0; p < plies && !ply.empty(); p++) {
+        std::vector<Bitboard> next;
+        for (Bitboard& board : ply) {
+            std::uint64_t key;
+            board.canonical(key);
+            if (!seen.insert(key).second) {
+                continue;
+            }
+            positions.push_back(board);
+
+            const Who me = board.who;
+            for (Bitboard::bits_t m = board.moves(me); m != 0; m &= m - 1) {
+                const unsigned i = Bitboard::lowest(m);
+                Bitboard child = board;
+                child.toggle(me, i);
+                child.who = me == Who::HOME ? Who::AWAY : Who::HOME;
+                child.num_moves++;
+                next.push_back(child);
+            }
+        }
+        ply.swap(next);
+    }
+
+    return positions;
+}
+
+/**
+ * \return the positions of the checkpoint file, the last one of each key.
+ *         A record cut short by the end of the file is ignored.
+ */
+std::unordered_map<std::uint64_t, OpeningBook::Entry>
+read_checkpoint(const std::string& path) {
+    std::unordered_map<std::uint64_t, OpeningBook::Entry> done;
+    std::ifstream ifs(path, std::ios::binary);
+    Record record;
+    while (ifs.read(reinterpret_cast<char*>(&record), sizeof(record))) {
+        done[record.key] = record.entry;
+    }
+    return done;
+}
+
+/**
+ * Searches the positions in parallel, each thread with a searcher of its
+ * own, and writes the book.
+ */
+int build_book(const unsigned plies,
+               const unsigned depth,
+               const unsigned threads,
+               const std::string& path,
+               const unsigned megabytes) {
+    const std::vector<Bitboard> positions = opening_positions(plies);
+    const std::string checkpoint_path = path + ".checkpoint";
+    std::unordered_map<std::uint64_t, OpeningBook::Entry> done =
+        read_checkpoint(checkpoint_path);
+
+    std::vector<const Bitboard*> todo;
+    for (const Bitboard& board : positions) {
+        std::uint64_t key;
+        board.canonical(key);
+        const auto found = done.find(key);
+        if (found == done.end() || found->second.depth < depth) {
+            todo.push_back(&board);
+        }
+    }
+    std::cout << positions.size() << " positions, "
+        << positions.size() - todo.size() << " in the checkpoint"
+        << std::endl;
+
+    std::ofstream checkpoint(checkpoint_path,
+                             std::ios::binary | std::ios::app);
+    std::mutex checkpoint_mutex;
+    std::atomic<size_t> next{0};
+    std::atomic<size_t> finished{0};
+    const double start = Timer::now();
+
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < threads; t++) {
+        workers.emplace_back([&] {
+            Searcher searcher;
+            searcher.set_mode(Searcher::Mode::PVS);
+            searcher.set_table_size(megabytes);
+            // Only the depth limits the search
+            searcher.set_move_time(1e9);
+
+            // The table is kept from one position to the next, they share
+            // much of their trees
+            for (size_t i = next++; i < todo.size(); i = next++) {
+                const Bitboard& board = *todo[i];
+                const Node best = searcher.search(board.to_state(), depth);
+
+                Record record;
+                const unsigned symmetry = board.canonical(record.key);
+                record.entry.score = best.score();
+                record.entry.depth = depth;
+                record.entry.move =
+                    board.transform_move(symmetry, best.parent_move);
+                record.entry.reserved = 0;
+
+                std::lock_guard<std::mutex> lock(checkpoint_mutex);
+                done[record.key] = record.entry;
+                checkpoint.write(reinterpret_cast<const char*>(&record),
+                                 sizeof(record));
+                checkpoint.flush();
+                std::cout << ++finished << "/" << todo.size()
+                    << "\tply " << board.num_moves
+                    << "\tscore " << record.entry.score
+                    << "\t" << Timer::now() - start << "s" << std::endl;
+            }
+        });
+    }
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+
+    // Only the positions of this run, a checkpoint of other arguments may
+    // hold more
+    std::vector<std::pair<std::uint64_t, OpeningBook::Entry>> book;
+    for (const Bitboard& board : positions) {
+        std::uint64_t key;
+        board.canonical(key);
+        book.emplace_back(key, done[key]);
+    }
+
+    const Bitboard board;
+    if (!OpeningBook::save(path, board.rows, board.cols, book)) {
+        std::cerr << "Could not write " << path << std::endl;
+        return 1;
+    }
+    std::remove(checkpoint_path.c_str());
+    std::cout << "Wrote " << book.size() << " positions to " << path
+        << std::endl;
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc > 1 && argv[1][0] == '-') {
+        std::cerr << "Usage: " << argv[0]
+            << " [plies] [depth] [threads] [file] [table megabytes]"
+            << std::endl;
+        return 1;
+    }
+
+    unsigned plies = argc > 1 ? std::atoi(argv[1]) : 3;
+    unsigned depth = argc > 2 ? std::atoi(argv[2]) : 12;
+    unsigned threads = argc > 3 && std::atoi(argv[3]) > 0
+        ? std::atoi(argv[3])
+        : std::thread::hardware_concurrency();
+    std::string path = argc > 4 ? argv[4] : "book.bin";
+    unsigned megabytes = argc > 5
+        ? std::atoi(argv[5])
+        : TranspositionTable::DEFAULT_MEGABYTES;
+
+    return build_book(plies, depth, threads, path, megabytes);
+}
+
+/* vim: tw=78:et:ts=4:sts=4:sw=4 */
@@ -0,0 +1,80 @@
+#include "Bitboard.h"
+#include "DfpnSolver.h"
+#include "GameState.h"
+#include "Timer.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+/**
+ * Proves who wins positions with df-pn, outside of a game. Each position is
+ * given in the format of GameState::parseMsg, as printed by
+ * Bitboard::to_msg; without one on the command line, they are read from
+ * the standard input, one per line. Run from the build directory so that
+ * the config directory is found.
+ *
+ * Usage: dfpn [seconds] [table megabytes] [position]
+ */
+
+/**
+ * Proves one position and prints what came out of it.
+ */
+void prove(DfpnSolver& solver, const std::string& msg, const double seconds) {
+    const Bitboard board = Bitboard::parse(msg);
+    Who winner;
+    Location move;
+
+    const double start = Timer::now();
+    const bool proven = solver.solve(board, start + seconds, winner, move);
+    const double elapsed = Timer::now() - start;
+    const long unsigned nodes = solver.get_nodes_searched();
+
+    if (proven) {
+        std::cout << GameState::who2str(winner) << " wins";
+        if (winner == board.who && move != Location()) {
+            std::cout << " with " << move.to_move().toString();
+        }
+    }
+    else {
+        std::cout << "Unproven, pn " << solver.get_proof_number()
+            << " dn " << solver.get_disproof_number();
+    }
+    std::cout << ", " << nodes << " nodes in " << elapsed << "s ("
+        << static_cast<long unsigned>(nodes / std::max(elapsed, 1e-6))
+        << " nodes/s)" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc > 1 && argv[1][0] == '-') {
+        std::cerr << "Usage: " << argv[0]
+            << " [seconds] [table megabytes] [position]" << std::endl;
+        return 1;
+    }
+
+    double seconds = argc > 1 ? std::atof(argv[1]) : 60;
+    unsigned megabytes = argc > 2
+        ? std::atoi(argv[2])
+        : DfpnSolver::DEFAULT_MEGABYTES;
+
+    // Positions of the same game share much of their trees, the table is
+    // kept from one to the next
+    DfpnSolver solver;
+    solver.set_table_size(megabytes);
+
+    if (argc > 3) {
+        prove(solver, argv[3], seconds);
+        return 0;
+    }
+
+    std::string line;
+    while (std::getline(std::cin, line)) {
+        if (!line.empty()) {
+            prove(solver, line, seconds);
+        }
+    }
+    return 0;
+}
+
+/* vim: tw=78:et:ts=4:sts=4:sw=4 */
@@ -0,0 +1,174 @@
+#include "Bitboard.h"
+#include "GameValues.h"
+#include "RegionDatabase.h"
+#include "Regions.h"
+#include "Timer.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+/**
+ * Builds the region database: computes the value of every shape of region
+ * up to some number of grids that fits on the board and where both teams
+ * can move, and writes them to a file that the searchers look up. Run from
+ * the build directory so that the config directory is found.
+ *
+ * Usage: regiondb [max grids] [threads] [file]
+ */
+
+using bits_t = Bitboard::bits_t;
+using id_t = GameValues::id_t;
+
+/**
+ * \return the shapes of region of each number of grids up to the given one
+ *         that fit on the board, by number of grids.
+ */
+std::vector<std::vector<bits_t>> all_shapes(const Bitboard& board,
+                                            const unsigned max_grids) {
+    const bits_t grids = board.empty();
+    const bits_t last_column = grids & ~board.not_last_column();
+
+    std::vector<std::vector<bits_t>> shapes(max_grids + 1);
+    if (max_grids == 0) {
+        return shapes;
+    }
+    shapes[1].push_back(1);
+
+    // Every shape is a smaller one and a grid next to it. Shapes sit in the
+    // top left corner, so they are moved away from it first to grow up and
+    // to the left.
+    for (unsigned n = 2; n <= max_grids; n++) {
+        std::unordered_set<bits_t> seen;
+        for (const bits_t smaller : shapes[n - 1]) {
+            std::vector<bits_t> placed{smaller};
+            if ((smaller & last_column) == 0) {
+                placed.push_back(smaller << 1);
+            }
+            for (size_t p = 0, end = placed.size(); p < end; p++) {
+                const bits_t down = placed[p] << board.cols;
+                if ((down & grids) == down
+                        && Bitboard::count(down) == n - 1) {
+                    placed.push_back(down);
+                }
+            }
+
+            for (const bits_t region : placed) {
+                const bits_t around = grids & ~region
+                    & ((region << 1 & board.not_first_column())
+                       | (region >> 1 & board.not_last_column())
+                       | region << board.cols
+                       | region >> board.cols);
+                for (bits_t g = around; g != 0; g &= g - 1) {
+                    const bits_t grown = Regions::shape(
+                        board, region | bits_t(1) << Bitboard::lowest(g));
+                    if (seen.insert(grown).second) {
+                        shapes[n].push_back(grown);
+                    }
+                }
+            }
+        }
+    }
+
+    return shapes;
+}
+
+/**
+ * Computes the values in parallel, each thread with values of its own, and
+ * writes the database.
+ */
+int build_database(const unsigned max_grids,
+                   const unsigned threads,
+                   const std::string& path) {
+    const Bitboard board;
+    const double start = Timer::now();
+
+    // Regions one team cannot move in are integers, and need no storing
+    std::vector<bits_t> todo;
+    const std::vector<std::vector<bits_t>> shapes =
+        all_shapes(board, max_grids);
+    for (unsigned n = 1; n < shapes.size(); n++) {
+        size_t contested = 0;
+        for (const bits_t shape : shapes[n]) {
+            if ((shape & shape >> 1 & board.not_last_column()) != 0
+                    && (shape & shape >> board.cols) != 0) {
+                todo.push_back(shape);
+                contested++;
+            }
+        }
+        std::cout << n << " grids: " << shapes[n].size() << " shapes, "
+            << contested << " where both teams can move" << std::endl;
+    }
+
+    std::vector<Regions> regions(threads);
+    std::vector<std::pair<unsigned, id_t>> values(todo.size());
+    std::atomic<size_t> next{0};
+
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < threads; t++) {
+        workers.emplace_back([&, t] {
+            for (size_t i = next++; i < todo.size(); i = next++) {
+                values[i] = {t, regions[t].value(board, todo[i])};
+            }
+        });
+    }
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    std::cout << "Computed " << todo.size() << " values in "
+        << Timer::now() - start << "s" << std::endl;
+
+    // Gather the values of all threads into one
+    GameValues merged;
+    std::vector<std::vector<id_t>> copied(threads);
+    std::vector<std::pair<bits_t, id_t>> database;
+    size_t outcomes[4] = {0, 0, 0, 0};
+    for (size_t i = 0; i < todo.size(); i++) {
+        const GameValues& from = regions[values[i].first].get_values();
+        const id_t game = merged.copy(
+            values[i].second,
+            [&from](const id_t g) -> const std::vector<id_t>& {
+                return from.left(g);
+            },
+            [&from](const id_t g) -> const std::vector<id_t>& {
+                return from.right(g);
+            },
+            copied[values[i].first]);
+        database.emplace_back(todo[i], game);
+        outcomes[static_cast<unsigned>(merged.sign(game))]++;
+    }
+    std::cout << outcomes[0] << " zero, " << outcomes[1] << " positive, "
+        << outcomes[2] << " negative, " << outcomes[3] << " fuzzy"
+        << std::endl;
+
+    if (!RegionDatabase::save(path, board.rows, board.cols, merged,
+                              database)) {
+        std::cerr << "Could not write " << path << std::endl;
+        return 1;
+    }
+    std::cout << "Wrote " << database.size() << " shapes to " << path
+        << std::endl;
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc > 1 && argv[1][0] == '-') {
+        std::cerr << "Usage: " << argv[0] << " [max grids] [threads] [file]"
+            << std::endl;
+        return 1;
+    }
+
+    unsigned max_grids = argc > 1 ? std::atoi(argv[1]) : 10;
+    unsigned threads = argc > 2 && std::atoi(argv[2]) > 0
+        ? std::atoi(argv[2])
+        : std::thread::hardware_concurrency();
+    std::string path = argc > 3 ? argv[3] : "regions.bin";
+
+    return build_database(max_grids, threads, path);
+}
+
+/* vim: tw=78:et:ts=4:sts=4:sw=4 */